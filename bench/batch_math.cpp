@@ -0,0 +1,102 @@
+// Artem Mikheev 2020
+// GNU GPLv3 License
+
+#include "bench.hpp"
+#include "math.hpp"
+#include "vector.hpp"
+#include <cmath>
+#include <random>
+
+// Math::sine, cosine, ln and arctg over arrays. The largest error in ulp against sinl,
+// cosl, logl and atanl on 2^20 random doubles, then ns per element on 4096-element buffers
+// Math:: functions. The scalar ln and arctg only get inputs they handle well, x in [1, 2) and |x| < 1
+// Math:: functions. The scalar ln and arctg only get inputs they handle: x >= 1 and |x| < 1
+
+typedef void (*Batch)(const double *in, double *out, size_t n);
+
+struct Function {
+	const char *name;
+	Batch batch, sse2, avx2, avx512;
+	long double (*reference)(long double);
+	double (*standard)(double);
+	long double (*scalar)(long double);
+	// random input for the batch forms and for the scalar one
+	double (*input)(std::mt19937_64 &generator);
+	double (*scalarInput)(std::mt19937_64 &generator);
+};
+
+template<typename K>
+void sse2(const double *in, double *out, size_t n) {
+	Math::Lanes::Unary<K>::template run<Math::Lanes::Width<16>>(in, out, n);
+}
+
+template<typename K>
+void avx2(const double *in, double *out, size_t n) {
+	Math::Lanes::runAvx2<Math::Lanes::Unary<K>>(in, out, n);
+}
+
+template<typename K>
+void avx512(const double *in, double *out, size_t n) {
+	Math::Lanes::runAvx512<Math::Lanes::Unary<K>>(in, out, n);
+}
+
+static double uniform(std::mt19937_64 &t_generator, double t_from, double t_to) {
+	return std::uniform_real_distribution<double>(t_from, t_to)(t_generator);
+}
+
+static double ulps(double t_value, long double t_reference) {
+	if (t_reference == 0)
+		return t_value == 0 ? 0 : INFINITY;
+	long double ulp = ldexpl(1, ilogbl(t_reference) - 52);
+	return (double) (fabsl(t_value - t_reference) / ulp);
+}
+
+int main() {
+	Function functions[] = {
+		{"sine", Math::sine, sse2<Math::Lanes::SineKernel<false>>, avx2<Math::Lanes::SineKernel<false>>,
+		 avx512<Math::Lanes::SineKernel<false>>, sinl, std::sin, Math::sine,
+		 [](std::mt19937_64 &g) { return uniform(g, -1.6e6, 1.6e6); }, [](std::mt19937_64 &g) { return uniform(g, -10, 10); }},
+		{"cosine", Math::cosine, sse2<Math::Lanes::SineKernel<true>>, avx2<Math::Lanes::SineKernel<true>>,
+		 avx512<Math::Lanes::SineKernel<true>>, cosl, std::cos, Math::cosine,
+		 [](std::mt19937_64 &g) { return uniform(g, -1.6e6, 1.6e6); }, [](std::mt19937_64 &g) { return uniform(g, -10, 10); }},
+		{"ln", Math::ln, sse2<Math::Lanes::LnKernel>, avx2<Math::Lanes::LnKernel>, avx512<Math::Lanes::LnKernel>,
+		 logl, std::log, Math::ln,
+		 [](std::mt19937_64 &g) { return ldexp(uniform(g, 1, 2), (int) (g() % 2001) - 1000); },
+		 [](std::mt19937_64 &g) { return uniform(g, 1, 2); }},
+		{"arctg", Math::arctg, sse2<Math::Lanes::ArctgKernel>, avx2<Math::Lanes::ArctgKernel>,
+		 avx512<Math::Lanes::ArctgKernel>, atanl, std::atan, Math::arctg,
+		 [](std::mt19937_64 &g) { return ldexp(uniform(g, -1, 1), (int) (g() % 61) - 30); },
+		 [](std::mt19937_64 &g) { return uniform(g, -0.99, 0.99); }},
+	};
+	bool hasAvx2 = __builtin_cpu_supports("avx2"), hasAvx512 = __builtin_cpu_supports("avx512f");
+	const size_t checked = 1 << 20, buffer = 4096;
+	std::mt19937_64 generator(1);
+	Vector<double> in(checked), out(checked), scalarIn(buffer);
+	printf("%-7s %9s %9s %9s %9s %9s %9s %9s\n", "", "max ulp", "batch", "sse2", "avx2", "avx512", "std::", "Math::");
+	for (const Function &f : functions) {
+		for (size_t i = 0; i < checked; i++)
+			in[i] = f.input(generator);
+		for (size_t i = 0; i < buffer; i++)
+			scalarIn[i] = f.scalarInput(generator);
+		double worst = 0;
+		f.batch(in.data(), out.data(), checked);
+		for (size_t i = 0; i < checked; i++)
+			worst = Algorithm::max(worst, ulps(out[i], f.reference(in[i])));
+		auto perElement = [&](Batch t_batch) {
+			return 1e9 / buffer * Bench::secondsPerCall([&] { t_batch(in.data(), out.data(), buffer); });
+		};
+		printf("%-7s %9.2f %9.2f %9.2f", f.name, worst, perElement(f.batch), perElement(f.sse2));
+		printf(hasAvx2 ? " %9.2f" : " %9s", hasAvx2 ? perElement(f.avx2) : (double) 0);
+		printf(hasAvx512 ? " %9.2f" : " %9s", hasAvx512 ? perElement(f.avx512) : (double) 0);
+		double standard = 1e9 / buffer * Bench::secondsPerCall([&] {
+			for (size_t i = 0; i < buffer; i++)
+				out[i] = f.standard(in[i]);
+		});
+		double scalar = 1e9 / buffer * Bench::secondsPerCall([&] {
+			for (size_t i = 0; i < buffer; i++)
+				out[i] = (double) f.scalar(scalarIn[i]);
+		});
+		printf(" %9.2f %9.2f\n", standard, scalar);
+	}
+	return 0;
+}
@@ -0,0 +1,59 @@
+// Artem Mikheev 2020
+// GNU GPLv3 License
+
+#include "random.hpp"
+#include "vartypes.hpp"
+#include <chrono>
+#include <cstdio>
+
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+// Timing helpers shared by the benchmarks. A round repeats the call until it has run for
+// at least 20 ms, and the best round of t_rounds gives the time per call, which keeps
+// other work on the host from inflating the result
+
+namespace Bench {
+	template<typename F>
+	double secondsPerCall(const F &t_call, int t_rounds = 5) {
+		typedef std::chrono::steady_clock Clock;
+		double best = 0;
+		for (int round = 0; round < t_rounds; round++) {
+			uint64 calls = 0;
+			Clock::time_point start = Clock::now();
+			double elapsed;
+			do {
+				t_call();
+				calls++;
+				elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+			} while (elapsed < 0.02);
+			if (round == 0 || elapsed / calls < best)
+				best = elapsed / calls;
+		}
+		return best;
+	}
+
+	// keeps the compiler from dropping a result nothing reads
+	template<typename T>
+	inline void keep(const T &t_value) {
+		asm volatile("" : : "g"(&t_value) : "memory");
+	}
+
+	inline void randomLimbs(uint64 *t_out, sizeT t_count, unsigned long long t_seed) {
+		xoshiro256x16 generator(t_seed);
+		generator.fill(t_out, t_count);
+	}
+
+	// a positive number of exactly t_limbs limbs, for BigInt or anything else with resize
+	// and operator[] on its limbs
+	template<typename Number>
+	Number randomNumber(sizeT t_limbs, unsigned long long t_seed) {
+		Number result((uint64) 1);
+		result.resize(t_limbs);
+		randomLimbs(&result[0], t_limbs, t_seed);
+		result[t_limbs - 1] |= 1ULL << 63;
+		return result;
+	}
+}
+
+#endif //BENCH_HPP
@@ -0,0 +1,85 @@
+// Artem Mikheev 2020
+// GNU GPLv3 License
+
+#include "bench.hpp"
+#include "math.hpp"
+#include "vector.hpp"
+#include <random>
+
+// Math::binaryGcd and the array forms on 65536 pairs, ns per pair, best of 7 rounds,
+// against a Euclid loop by division, the gcd this replaced. Then lcmPairs and gcdAll,
+// the latter against folding the array with Euclid's gcd
+
+static unsigned long long euclid(unsigned long long a, unsigned long long b) {
+	while (b) {
+		unsigned long long r = a % b;
+		a = b;
+		b = r;
+	}
+	return a;
+}
+
+int main() {
+	const size_t count = 65536;
+	std::mt19937_64 generator(1);
+	Vector<long long> a(count), b(count), out(count);
+	struct Case {
+		const char *name;
+		int bits;
+		bool common;
+	} cases[] = {{"random 63-bit", 63, false}, {"random 31-bit", 31, false}, {"40-bit common factor", 23, true}};
+	auto perPair = [&](const auto &t_call) {
+		return 1e9 / count * Bench::secondsPerCall(t_call, 7);
+	};
+	printf("%-22s %9s %9s %9s\n", "", "euclid", "binary", "gcdPairs");
+	for (const Case &c : cases) {
+		unsigned long long factor = (generator() >> 24) | (1ULL << 39);
+		for (size_t i = 0; i < count; i++) {
+			a[i] = generator() >> (64 - c.bits);
+			b[i] = generator() >> (64 - c.bits);
+			if (c.common) {
+				a[i] *= factor;
+				b[i] *= factor;
+			}
+		}
+		Math::gcdPairs(a.data(), b.data(), out.data(), count);
+		for (size_t i = 0; i < count; i++)
+			if ((unsigned long long) out[i] != euclid(a[i], b[i])) {
+				printf("gcdPairs is wrong for %lld and %lld\n", a[i], b[i]);
+				return 1;
+			}
+		double oldGcd = perPair([&] {
+			for (size_t i = 0; i < count; i++)
+				out[i] = euclid(a[i], b[i]);
+		});
+		double binary = perPair([&] {
+			for (size_t i = 0; i < count; i++)
+				out[i] = Math::binaryGcd(a[i], b[i]);
+		});
+		double pairs = perPair([&] { Math::gcdPairs(a.data(), b.data(), out.data(), count); });
+		printf("%-22s %9.1f %9.1f %9.1f\n", c.name, oldGcd, binary, pairs);
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		a[i] = generator() >> 33;
+		b[i] = generator() >> 33;
+	}
+	printf("lcmPairs on 31-bit pairs: %.1f ns per pair\n", perPair([&] { Math::lcmPairs(a.data(), b.data(), out.data(), count); }));
+
+	unsigned long long factor = (generator() >> 24) | (1ULL << 39);
+	for (size_t i = 0; i < count; i++)
+		a[i] = (long long) (factor * (generator() >> 41));
+	if ((unsigned long long) Math::gcdAll(a.data(), count) % factor != 0) {
+		printf("gcdAll is wrong\n");
+		return 1;
+	}
+	double all = perPair([&] { Bench::keep(Math::gcdAll(a.data(), count)); });
+	double folded = perPair([&] {
+		unsigned long long result = 0;
+		for (size_t i = 0; i < count; i++)
+			result = euclid(result, a[i]);
+		Bench::keep(result);
+	});
+	printf("gcdAll over multiples of a 40-bit number: %.1f ns per value, Euclid fold %.1f\n", all, folded);
+	return 0;
+}
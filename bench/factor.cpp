@@ -0,0 +1,65 @@
+// Artem Mikheev 2020
+// GNU GPLv3 License
+
+#include "bench.hpp"
+#include "math.hpp"
+#include "vector.hpp"
+#include <random>
+
+// Math::factor over arrays of semiprimes whose two prime factors have half the bits each,
+// from 32 to 62 bits, and Math::isPrime on random odd 64-bit numbers and on 64-bit primes.
+// Every factorization is multiplied back and its factors are checked with isPrime
+
+static unsigned long long randomPrime(std::mt19937_64 &t_generator, int t_bits) {
+	unsigned long long n = (t_generator() >> (64 - t_bits)) | (1ULL << (t_bits - 1)) | 1;
+	while (!Math::isPrime(n))
+		n += 2;
+	return n;
+}
+
+int main() {
+	std::mt19937_64 generator(1);
+	printf("%5s %12s %12s\n", "bits", "per number", "per second");
+	for (int bits : {32, 40, 48, 56, 62}) {
+		size_t count = bits > 50 ? 64 : 1024;
+		Vector<unsigned long long> values(count);
+		Vector<Math::Factorization> factors(count);
+		for (size_t i = 0; i < count; i++)
+			values[i] = randomPrime(generator, bits / 2) * randomPrime(generator, bits - bits / 2);
+		Math::factor(values.data(), count, factors.data());
+		for (size_t i = 0; i < count; i++) {
+			unsigned long long product = 1;
+			for (int j = 0; j < factors[i].count; j++)
+				for (int e = 0; e < factors[i].exponents[j]; e++) {
+					if (!Math::isPrime(factors[i].primes[j])) {
+						printf("factor of %llu isn't prime\n", values[i]);
+						return 1;
+					}
+					product *= factors[i].primes[j];
+				}
+			if (product != values[i]) {
+				printf("factors of %llu don't multiply back\n", values[i]);
+				return 1;
+			}
+		}
+		double seconds = Bench::secondsPerCall([&] { Math::factor(values.data(), count, factors.data()); }, 3) / count;
+		printf("%5d %9.1f us %12.0f\n", bits, seconds * 1e6, 1 / seconds);
+	}
+
+	const size_t count = 4096;
+	Vector<unsigned long long> odd(count), primes(count);
+	for (size_t i = 0; i < count; i++) {
+		odd[i] = generator() | 1;
+		primes[i] = randomPrime(generator, 64);
+	}
+	auto perNumber = [&](const Vector<unsigned long long> &t_values) {
+		return 1e6 / count * Bench::secondsPerCall([&] {
+			size_t found = 0;
+			for (size_t i = 0; i < count; i++)
+				found += Math::isPrime(t_values[i]);
+			Bench::keep(found);
+		});
+	};
+	printf("isPrime: random odd 64-bit %.2f us, 64-bit primes %.2f us\n", perNumber(odd), perNumber(primes));
+	return 0;
+}
@@ -0,0 +1,74 @@
+// Artem Mikheev 2020
+// GNU GPLv3 License
+
+#include "bench.hpp"
+#include "fft.hpp"
+#include <cstdlib>
+#include <random>
+
+// FFTPlan<double>::forward against a naive long double DFT, as the worst error relative to
+// the largest output, then forward transform times for powers of two up to the first
+// argument, 2^22 by default, for Bluestein sizes and for RealFFTPlan of the same lengths.
+// The complex times include copying the input back before each transform
+
+static double worstError(sizeT n, std::mt19937_64 &t_generator) {
+	std::uniform_real_distribution<double> uniform(-1, 1);
+	Vector<Complex<double>> data(n);
+	Vector<long double> re(n), im(n), rootRe(n), rootIm(n);
+	for (sizeT i = 0; i < n; i++) {
+		re[i] = uniform(t_generator);
+		im[i] = uniform(t_generator);
+		data[i] = Complex<double>(re[i], im[i]);
+		long double angle = -2 * Math::pi * i / n;
+		rootRe[i] = cosl(angle);
+		rootIm[i] = sinl(angle);
+	}
+	FFTPlan<double>::cached(n).forward(data.data());
+	long double worst = 0, largest = 0;
+	for (sizeT k = 0; k < n; k++) {
+		long double sumRe = 0, sumIm = 0;
+		for (sizeT j = 0, at = 0; j < n; j++, at = (at + k) % n) {
+			sumRe += re[j] * rootRe[at] - im[j] * rootIm[at];
+			sumIm += re[j] * rootIm[at] + im[j] * rootRe[at];
+		}
+		worst = Algorithm::max(worst, hypotl(data[k].real() - sumRe, data[k].imag() - sumIm));
+		largest = Algorithm::max(largest, hypotl(sumRe, sumIm));
+	}
+	return (double) (worst / largest);
+}
+
+int main(int argc, char **argv) {
+	sizeT largest = argc > 1 ? (sizeT) atol(argv[1]) : 1 << 22;
+	std::mt19937_64 generator(1);
+	printf("relative error against a long double DFT:");
+	for (sizeT n : {64u, 1000u, 1024u, 4096u, 4097u})
+		printf(" %u: %.1e", n, worstError(n, generator));
+	printf("\n\n%9s %12s %12s\n", "points", "complex", "real");
+	Vector<sizeT> sizes;
+	for (sizeT n = 1 << 10; n <= largest; n *= 4)
+		sizes.push(n);
+	sizes.push(1000);
+	if (1000000 <= largest)
+		sizes.push(1000000);
+	for (sizeT i = 0; i < *sizes.size; i++) {
+		sizeT n = sizes[i];
+		Vector<Complex<double>> input(n), data(n), spectrum(n / 2 + 1);
+		Vector<double> real(n);
+		std::uniform_real_distribution<double> uniform(-1, 1);
+		for (sizeT j = 0; j < n; j++) {
+			input[j] = Complex<double>(uniform(generator), uniform(generator));
+			real[j] = uniform(generator);
+		}
+		const FFTPlan<double> &plan = FFTPlan<double>::cached(n);
+		const RealFFTPlan<double> &realPlan = RealFFTPlan<double>::cached(n);
+		int rounds = n > (1 << 20) ? 1 : 3;
+		// the copy keeps repeated transforms from growing the values until they overflow
+		double complexTime = Bench::secondsPerCall([&] {
+			memcpy(data.data(), input.data(), n * sizeof(Complex<double>));
+			plan.forward(data.data());
+		}, rounds);
+		double realTime = Bench::secondsPerCall([&] { realPlan.forward(real.data(), spectrum.data()); }, rounds);
+		printf("%9u %9.3f ms %9.3f ms\n", n, complexTime * 1e3, realTime * 1e3);
+	}
+	return 0;
+}
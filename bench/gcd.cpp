@@ -0,0 +1,50 @@
+// Artem Mikheev 2020
+// GNU GPLv3 License
+
+#include "bench.hpp"
+#include "string.hpp"
+#include "utility.hpp"
+#include "big.hpp"
+#include <cstdlib>
+
+// BigInt::gcd and gcdext on random pairs of n limbs against Euclid's algorithm through
+// operator%, which only runs up to 3000 limbs. Sizes go up to the first argument, 10000
+// limbs by default. The half-gcd threshold can be checked by rebuilding with
+// Limbs::halfGcdThreshold changed and comparing the 1000 and 3000 limb rows
+
+static BigInt euclid(BigInt a, BigInt b) {
+	while (*b.size) {
+		BigInt r = a % b;
+		a = std::move(b);
+		b = std::move(r);
+	}
+	return a;
+}
+
+int main(int argc, char **argv) {
+	sizeT largest = argc > 1 ? (sizeT) atol(argv[1]) : 10000;
+	printf("%7s %12s %12s %12s\n", "limbs", "gcd", "gcdext", "euclid");
+	for (sizeT limbs : {64u, 300u, 1000u, 3000u, 10000u, 30000u, 100000u}) {
+		if (limbs > largest)
+			break;
+		BigInt a = Bench::randomNumber<BigInt>(limbs, 1), b = Bench::randomNumber<BigInt>(limbs, 2), x, y;
+		BigInt g = a.gcd(b);
+		if (!(a.gcdext(b, x, y) == g) || !(a * x + b * y == g)) {
+			printf("gcdext disagrees with gcd at %u limbs\n", limbs);
+			return 1;
+		}
+		int rounds = limbs > 3000 ? 1 : 3;
+		double plain = Bench::secondsPerCall([&] { Bench::keep(a.gcd(b)); }, rounds);
+		double extended = Bench::secondsPerCall([&] { Bench::keep(a.gcdext(b, x, y)); }, rounds);
+		printf("%7u %9.2f ms %9.2f ms", limbs, plain * 1e3, extended * 1e3);
+		if (limbs <= 3000) {
+			if (!(euclid(a, b) == g)) {
+				printf("\ngcd disagrees with Euclid at %u limbs\n", limbs);
+				return 1;
+			}
+			printf(" %9.2f ms", 1e3 * Bench::secondsPerCall([&] { Bench::keep(euclid(a, b)); }, rounds));
+		}
+		printf("\n");
+	}
+	return 0;
+}
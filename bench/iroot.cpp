@@ -0,0 +1,43 @@
+// Artem Mikheev 2020
+// GNU GPLv3 License
+
+#include "bench.hpp"
+#include "string.hpp"
+#include "utility.hpp"
+#include "big.hpp"
+
+// BigInt::isqrt and iroot(3) on random n-limb numbers next to one multiplication of two
+// n-limb numbers and one division of n limbs by n/2, the operations Newton's steps are made
+// of. Then isPerfectPower on x^6 and x^6 + 1 for a random 2000 limb x
+
+int main() {
+	printf("%7s %12s %12s %12s %12s\n", "limbs", "isqrt", "cbrt", "mul", "div");
+	for (sizeT limbs : {64u, 1024u, 16384u, 65536u}) {
+		BigInt n = Bench::randomNumber<BigInt>(limbs, 1), other = Bench::randomNumber<BigInt>(limbs, 2);
+		BigInt half = Bench::randomNumber<BigInt>(limbs / 2, 3);
+		BigInt root = n.isqrt(), cube = n.iroot(3);
+		BigInt next = root + BigInt((uint64) 1), nextCube = cube + BigInt((uint64) 1);
+		if (n < root * root || !(n < next * next) || n < cube * cube * cube || !(n < nextCube * nextCube * nextCube)) {
+			printf("wrong root at %u limbs\n", limbs);
+			return 1;
+		}
+		int rounds = limbs > 4096 ? 1 : 3;
+		printf("%7u %9.1f us %9.1f us %9.1f us %9.1f us\n", limbs,
+		       1e6 * Bench::secondsPerCall([&] { Bench::keep(n.isqrt()); }, rounds),
+		       1e6 * Bench::secondsPerCall([&] { Bench::keep(n.iroot(3)); }, rounds),
+		       1e6 * Bench::secondsPerCall([&] { Bench::keep(n * other); }, rounds),
+		       1e6 * Bench::secondsPerCall([&] { Bench::keep(n / half); }, rounds));
+	}
+	BigInt x = Bench::randomNumber<BigInt>(2000, 4), power = x * x * x;
+	power = power * power;
+	BigInt nearPower = power + BigInt((uint64) 1), base;
+	uint32 exponent = 0;
+	if (!power.isPerfectPower(&base, &exponent) || exponent != 6 || !(base == x) || nearPower.isPerfectPower()) {
+		printf("isPerfectPower is wrong\n");
+		return 1;
+	}
+	printf("isPerfectPower on %u limbs: x^6 %.1f ms, x^6 + 1 %.1f ms\n", *power.size,
+	       1e3 * Bench::secondsPerCall([&] { Bench::keep(power.isPerfectPower()); }, 1),
+	       1e3 * Bench::secondsPerCall([&] { Bench::keep(nearPower.isPerfectPower()); }, 1));
+	return 0;
+}
@@ -0,0 +1,67 @@
+// Artem Mikheev 2020
+// GNU GPLv3 License
+
+#include "bench.hpp"
+#include "string.hpp"
+#include "utility.hpp"
+#include "big.hpp"
+
+// Tunes Limbs::karatsubaThreshold, toom3Threshold and nttThreshold. For each pair of
+// neighbouring algorithms it times one step of the larger one, whose sub-products go through
+// mulBalanced as usual, against the smaller one on the whole operands. The suggested
+// threshold minimizes the time over all the sizes tried, each counted relative to the faster
+// algorithm at that size, so a single noisy size can't move it far
+
+struct Algorithm2 {
+	const char *name;
+	void (*run)(uint64 *r, const uint64 *a, const uint64 *b, sizeT n, uint64 *scratch);
+};
+
+static void basecase(uint64 *r, const uint64 *a, const uint64 *b, sizeT n, uint64 *) {
+	Limbs::mulBasecase(r, a, n, b, n);
+}
+
+static void ntt(uint64 *r, const uint64 *a, const uint64 *b, sizeT n, uint64 *) {
+	Limbs::nttMul(r, a, n, b, n);
+}
+
+static sizeT crossover(const Algorithm2 &t_small, const Algorithm2 &t_large, sizeT t_from, sizeT t_to, sizeT t_current) {
+	printf("\n%8s %14s %14s\n", "limbs", t_small.name, t_large.name);
+	Vector<uint64> a(t_to), b(t_to), r(2 * t_to), scratch(Limbs::mulScratchSize(t_to));
+	Bench::randomLimbs(a.data(), t_to, 1);
+	Bench::randomLimbs(b.data(), t_to, 2);
+	Vector<sizeT> sizes;
+	Vector<double> smallTimes, largeTimes;
+	for (sizeT n = t_from; n <= t_to; n += Algorithm::max((sizeT) 1, n / 8)) {
+		double small = Bench::secondsPerCall([&] { t_small.run(r.data(), a.data(), b.data(), n, scratch.data()); });
+		double large = Bench::secondsPerCall([&] { t_large.run(r.data(), a.data(), b.data(), n, scratch.data()); });
+		printf("%8u %12.2f us %12.2f us\n", n, small * 1e6, large * 1e6);
+		sizes.push(n);
+		smallTimes.push(small);
+		largeTimes.push(large);
+	}
+	// cost of switching at sizes[i]: the small algorithm below it, the large one from it on
+	sizeT suggested = sizes[0];
+	double best = 0;
+	for (sizeT i = 0; i <= *sizes.size; i++) {
+		double cost = 0;
+		for (sizeT j = 0; j < *sizes.size; j++) {
+			double fastest = Algorithm::min(smallTimes[j], largeTimes[j]);
+			cost += (j < i ? smallTimes[j] : largeTimes[j]) / fastest;
+		}
+		if (i == 0 || cost < best) {
+			best = cost;
+			suggested = i < *sizes.size ? sizes[i] : t_to + 1;
+		}
+	}
+	printf("%s from %u limbs, currently %u\n", t_large.name, suggested, t_current);
+	return suggested;
+}
+
+int main() {
+	Algorithm2 algorithms[] = {{"basecase", basecase}, {"karatsuba", Limbs::karatsuba}, {"toom3", Limbs::toom3}, {"ntt", ntt}};
+	crossover(algorithms[0], algorithms[1], 8, 96, Limbs::karatsubaThreshold);
+	crossover(algorithms[1], algorithms[2], 64, 768, Limbs::toom3Threshold);
+	crossover(algorithms[2], algorithms[3], 1024, 16384, Limbs::nttThreshold);
+	return 0;
+}
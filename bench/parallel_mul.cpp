@@ -0,0 +1,42 @@
+// Artem Mikheev 2020
+// GNU GPLv3 License
+
+#include "bench.hpp"
+#include "string.hpp"
+#include "utility.hpp"
+#include "big.hpp"
+#include "thread_pool.hpp"
+#include <cstdlib>
+#include <thread>
+
+// Scaling of BigInt multiplication with BigInt::setThreadPool on random operands of the
+// first argument's limbs, 2^20 by default. Runs with 2, 4, 8, ... threads up to the hardware
+// threads, counting the caller of parallelFor as one of them, against the same product
+// without a pool. A single core still gets the 2 thread run, which shows the pool's
+// overhead. Every pooled product is compared with the single-threaded one
+
+int main(int argc, char **argv) {
+	sizeT limbs = argc > 1 ? (sizeT) atol(argv[1]) : 1 << 20;
+	sizeT hardware = Algorithm::max((sizeT) 1, (sizeT) std::thread::hardware_concurrency());
+	BigInt a = Bench::randomNumber<BigInt>(limbs, 1), b = Bench::randomNumber<BigInt>(limbs, 2);
+	BigInt expected = a * b;
+	double single = Bench::secondsPerCall([&] { Bench::keep(a * b); }, 3);
+	printf("%u x %u limbs, %u hardware threads\n", limbs, limbs, hardware);
+	printf("%8s %12s %9s\n", "threads", "time", "speedup");
+	printf("%8u %9.0f ms %9.2f\n", 1, single * 1e3, 1.0);
+	for (sizeT threads = 2;; threads = Algorithm::min(2 * threads, hardware)) {
+		sizeT workers = threads - 1;
+		ThreadPool pool(workers);
+		BigInt::setThreadPool(&pool);
+		if (!(a * b == expected)) {
+			printf("the product with %u workers differs\n", workers);
+			return 1;
+		}
+		double pooled = Bench::secondsPerCall([&] { Bench::keep(a * b); }, 3);
+		BigInt::setThreadPool(nullptr);
+		printf("%8u %9.0f ms %9.2f\n", threads, pooled * 1e3, single / pooled);
+		if (threads >= hardware)
+			break;
+	}
+	return 0;
+}
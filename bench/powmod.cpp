@@ -0,0 +1,45 @@
+// Artem Mikheev 2020
+// GNU GPLv3 License
+
+#include "bench.hpp"
+#include "string.hpp"
+#include "utility.hpp"
+#include "big.hpp"
+
+// BigInt::powmod against left-to-right square-and-multiply with operator%, for random
+// moduli and exponents of the same length. Odd moduli go through Montgomery, even ones
+// through Barrett
+
+static BigInt squareAndMultiply(const BigInt &t_base, const BigInt &t_exponent, const BigInt &t_modulus) {
+	BigInt result((uint64) 1);
+	for (sizeT i = *t_exponent.size; i-- > 0;)
+		for (int bit = 63; bit >= 0; bit--) {
+			result = result * result % t_modulus;
+			if ((t_exponent[i] >> bit) & 1)
+				result = result * t_base % t_modulus;
+		}
+	return result;
+}
+
+int main() {
+	printf("%6s %14s %14s %14s\n", "bits", "montgomery", "barrett", "plain");
+	for (sizeT bits : {1024u, 2048u, 4096u, 8192u}) {
+		sizeT limbs = bits / 64;
+		BigInt base = Bench::randomNumber<BigInt>(limbs, 1), exponent = Bench::randomNumber<BigInt>(limbs, 2);
+		BigInt odd = Bench::randomNumber<BigInt>(limbs, 3), even = odd;
+		odd[0] |= 1;
+		even[0] &= ~1ULL;
+		base = base % odd;
+		BigInt expected = squareAndMultiply(base, exponent, odd);
+		if (!(base.powmod(exponent, odd) == expected) || !(base.powmod(exponent, even) == squareAndMultiply(base, exponent, even))) {
+			printf("powmod disagrees with square-and-multiply at %u bits\n", bits);
+			return 1;
+		}
+		int rounds = bits > 4096 ? 1 : 3;
+		double montgomery = Bench::secondsPerCall([&] { Bench::keep(base.powmod(exponent, odd)); }, rounds);
+		double barrett = Bench::secondsPerCall([&] { Bench::keep(base.powmod(exponent, even)); }, rounds);
+		double plain = Bench::secondsPerCall([&] { Bench::keep(squareAndMultiply(base, exponent, odd)); }, rounds);
+		printf("%6u %11.2f ms %11.2f ms %11.2f ms\n", bits, montgomery * 1e3, barrett * 1e3, plain * 1e3);
+	}
+	return 0;
+}
@@ -0,0 +1,68 @@
+// Artem Mikheev 2020
+// GNU GPLv3 License
+
+#include "bench.hpp"
+#include "vector.hpp"
+#include <cstdlib>
+
+// xoshiro256x16::fill in ns per value at 2^14, 2^20 and up to the first argument's values,
+// 2^24 by default, against a loop over xorshift64's operator(). Fills of at least
+// RandomLanes::streamThreshold values use streaming stores. Then the lane kernel at each
+// vector width on a buffer that stays in cache, after checking that the widths agree
+
+typedef void (*Kernel)(unsigned long long (*state)[RandomLanes::count], uint64_t *out, size_t blocks);
+
+static void sse2(unsigned long long (*t_state)[RandomLanes::count], uint64_t *out, size_t t_blocks) {
+	RandomLanes::Xoshiro<false>::run<RandomLanes::Width<16>>(t_state, out, t_blocks);
+}
+
+static void avx2(unsigned long long (*t_state)[RandomLanes::count], uint64_t *out, size_t t_blocks) {
+	RandomLanes::runAvx2<RandomLanes::Xoshiro<false>>(t_state, out, t_blocks);
+}
+
+static void avx512(unsigned long long (*t_state)[RandomLanes::count], uint64_t *out, size_t t_blocks) {
+	RandomLanes::runAvx512<RandomLanes::Xoshiro<false>>(t_state, out, t_blocks);
+}
+
+int main(int argc, char **argv) {
+	size_t largest = argc > 1 ? (size_t) atoll(argv[1]) : size_t(1) << 24;
+	printf("%10s %10s %12s\n", "values", "fill", "xorshift64");
+	for (size_t n : {size_t(1) << 14, size_t(1) << 20, largest}) {
+		// 64 byte aligned, so the large fill can stream
+		uint64_t *out = (uint64_t *) aligned_alloc(64, n * sizeof(uint64_t));
+		xoshiro256x16 generator(1);
+		xorshift64 scalar;
+		int rounds = n > (size_t(1) << 22) ? 2 : 5;
+		double fill = Bench::secondsPerCall([&] { generator.fill(out, n); }, rounds);
+		double loop = Bench::secondsPerCall([&] {
+			for (size_t i = 0; i < n; i++)
+				out[i] = scalar();
+		}, rounds);
+		printf("%10zu %10.2f %12.2f\n", n, fill * 1e9 / n, loop * 1e9 / n);
+		free(out);
+	}
+
+	const size_t blocks = 1024;
+	Kernel kernels[] = {sse2, avx2, avx512};
+	const char *names[] = {"sse2", "avx2", "avx512"};
+	bool supported[] = {true, __builtin_cpu_supports("avx2") != 0, __builtin_cpu_supports("avx512f") != 0};
+	Vector<uint64_t> reference(blocks * RandomLanes::count), out(blocks * RandomLanes::count);
+	printf("\nin cache, ns per value:");
+	for (int k = 0; k < 3; k++) {
+		if (!supported[k])
+			continue;
+		unsigned long long state[4][RandomLanes::count];
+		for (int w = 0; w < 4; w++)
+			for (int lane = 0; lane < RandomLanes::count; lane++)
+				state[w][lane] = 0x9e3779b97f4a7c15ULL * (4 * lane + w + 1);
+		kernels[k](state, (k ? out : reference).data(), blocks);
+		if (k && memcmp(out.data(), reference.data(), blocks * RandomLanes::count * sizeof(uint64_t)) != 0) {
+			printf("\n%s disagrees with sse2\n", names[k]);
+			return 1;
+		}
+		double seconds = Bench::secondsPerCall([&] { kernels[k](state, out.data(), blocks); });
+		printf(" %s %.2f", names[k], seconds * 1e9 / (blocks * RandomLanes::count));
+	}
+	printf("\n");
+	return 0;
+}
@@ -1,16 +1,20 @@
 // Artem Mikheev 2020
 // GNU GPLv3 License
 
+#include "ntt.hpp"
+#include "thread_pool.hpp"
+#include "vartypes.hpp"
+#include <cmath>
+#include <cstdio>
+#include <fcntl.h>
+#include <memory>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #ifndef CPP_LIB_BIG_HPP
 #define CPP_LIB_BIG_HPP
 
-typedef uint64_t uint64;
-typedef int64_t int64;
-typedef uint32_t uint32;
-typedef int32_t int32;
-typedef uint8_t ubyte;
-typedef uint16_t uint16;
-typedef int16_t int16;
 struct uint128 {
 	uint64_t a, b;
 };
@@ -43,45 +47,6 @@ uint128 div128by64(uint128 a, uint64 b) {
 	return a;
 }
 
-uint64 add64(uint64 a, uint64 b, ubyte *carry) {
-	asm volatile(
-	"add %[b], %[a]\n\t"
-	"jnc nocarry\n\t"
-	"movb $0x1, (%[car])\n\t"
-	"nocarry:\n\t"
-	: [a]"+r"(a), [car]"+r"(carry)
-	: [b]"r"(b)
-	: "cc", "memory"
-	);
-	return a;
-}
-
-uint128 add64to128(uint128 a, uint64 b) {
-	asm volatile(
-	"add %[b], %[rb]\n\t"
-	"jnc nocarry1\n\t"
-	"add $0x1, %[ra]\n\t"
-	"nocarry1:\n\t"
-	: [ra]"+r"(a.a), [rb]"+r"(a.b)
-	: [b]"r"(b)
-	: "cc", "memory"
-	);
-	return a;
-}
-
-uint64 sub64(uint64 a, uint64 b, ubyte *borrow) {
-	asm volatile(
-	"sub %[b], %[a]\n\t"
-	"jnc noborrow\n\t"
-	"movb $0x1, (%[bor])\n\t"
-	"noborrow:\n\t"
-	: [a]"+r"(a), [bor]"+r"(borrow)
-	: [b]"r"(b)
-	: "cc", "memory"
-	);
-	return a;
-}
-
 inline uint64 getReciprocal64(uint64 a) {
 	return (div128by64({1, 0}, a).a + 1);
 }
@@ -94,99 +59,1279 @@ inline uint64 getModFromDiv(uint64 a, uint64 b, uint64 c) {
 	return a - b * c;
 }
 
-class BigInt {
-private:
-	static const uint64 _cellMax = 0xffffffffffffffffULL;
-	Vector<uint64> _data;
+// Reciprocal of a normalized divisor (top bit set), floor((2^128 - 1) / d) - 2^64
+inline uint64 getNormalizedReciprocal64(uint64 d) {
+	return div128by64({~d, ~0ULL}, d).a;
+}
 
-	void removeLeadingZeros() {
-		while (*size && _data.back() == 0)
-			_data.pop();
-		if (*size == 0)
-			sign = 0;
+// Divides a by normalized d using its reciprocal instead of the div instruction,
+// a.a must be less than d. Like div128by64, returns the quotient in .a and the remainder in .b
+inline uint128 div128by64UsingRecip(uint128 a, uint64 d, uint64 recip) {
+	unsigned __int128 q = (unsigned __int128) recip * a.a;
+	q += ((unsigned __int128) (a.a + 1) << 64) | a.b;
+	uint64 q1 = (uint64) (q >> 64), q0 = (uint64) q;
+	uint64 r = a.b - q1 * d;
+	if (r > q0) {
+		q1--;
+		r += d;
+	}
+	if (r >= d) {
+		q1++;
+		r -= d;
 	}
+	return {q1, r};
+}
 
-	void addTwoBigInts(const BigInt *a, ubyte signa, const BigInt *b, ubyte signb, BigInt *res) {
-		res->sign = 0;
-		if (signa) {
-			if (signb) {
-				res->sign = 1;
+// Limb-array kernels that work on raw little-endian uint64 arrays.
+// BigInt keeps the sign and the storage, these functions only do the arithmetic,
+// so the fast multiplication algorithms can recurse on sub-arrays without copying.
+
+namespace Limbs {
+	typedef unsigned __int128 wide;
+
+	// Operand sizes (in limbs) at which the multiplication switches algorithm,
+	// measured on x86-64 with bench/mul_thresholds.cpp
+	const sizeT karatsubaThreshold = 24;
+	const sizeT toom3Threshold = 192;
+	const sizeT nttThreshold = 4096;
+
+	inline int cmp(const uint64 *a, const uint64 *b, sizeT n) {
+		while (n--) {
+			if (a[n] != b[n])
+				return a[n] < b[n] ? -1 : 1;
+		}
+		return 0;
+	}
+
+	inline void zero(uint64 *r, sizeT n) {
+		for (sizeT i = 0; i < n; i++)
+			r[i] = 0;
+	}
+
+	inline void copy(uint64 *r, const uint64 *a, sizeT n) {
+		for (sizeT i = 0; i < n; i++)
+			r[i] = a[i];
+	}
+
+	// Portable versions of the carry-chain kernels. Each takes the carry (or borrow)
+	// coming into the lowest limb, so the assembly kernels below can hand them
+	// whatever is left over after their unrolled blocks
+
+	inline uint64 addNPortable(uint64 *r, const uint64 *a, const uint64 *b, sizeT n, uint64 carry) {
+		for (sizeT i = 0; i < n; i++) {
+			wide cur = (wide) a[i] + b[i] + carry;
+			r[i] = (uint64) cur;
+			carry = (uint64) (cur >> 64);
+		}
+		return carry;
+	}
+
+	inline uint64 subNPortable(uint64 *r, const uint64 *a, const uint64 *b, sizeT n, uint64 borrow) {
+		for (sizeT i = 0; i < n; i++) {
+			uint64 ai = a[i], bi = b[i];
+			uint64 cur = ai - bi - borrow;
+			borrow = (ai < bi) | ((ai == bi) & borrow);
+			r[i] = cur;
+		}
+		return borrow;
+	}
+
+	inline uint64 mul1Portable(uint64 *r, const uint64 *a, sizeT n, uint64 b, uint64 carry) {
+		for (sizeT i = 0; i < n; i++) {
+			wide cur = (wide) a[i] * b + carry;
+			r[i] = (uint64) cur;
+			carry = (uint64) (cur >> 64);
+		}
+		return carry;
+	}
+
+	inline uint64 addMul1Portable(uint64 *r, const uint64 *a, sizeT n, uint64 b, uint64 carry) {
+		for (sizeT i = 0; i < n; i++) {
+			wide cur = (wide) a[i] * b + r[i] + carry;
+			r[i] = (uint64) cur;
+			carry = (uint64) (cur >> 64);
+		}
+		return carry;
+	}
+
+	inline uint64 subMul1Portable(uint64 *r, const uint64 *a, sizeT n, uint64 b, uint64 carry) {
+		for (sizeT i = 0; i < n; i++) {
+			wide cur = (wide) a[i] * b + carry;
+			uint64 low = (uint64) cur, ri = r[i];
+			carry = (uint64) (cur >> 64) + (ri < low);
+			r[i] = ri - low;
+		}
+		return carry;
+	}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define CPP_LIB_BIG_ASM_KERNELS
+
+	// The kernels below work on blocks of four limbs and keep the carry in the flags
+	// for the whole loop: lea and dec don't touch CF, and the loops that also need OF
+	// count down in rcx with jrcxz. r may be equal to a or b
+
+	// MULX comes with BMI2 and ADCX/ADOX with ADX, checked once with CPUID
+	inline bool hasAdx() {
+		static const bool result = [] {
+			uint32 eax = 0, ebx, ecx = 0, edx;
+			asm("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+			if (eax < 7)
+				return false;
+			eax = 7;
+			ecx = 0;
+			asm("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+			// ebx bit 8 is BMI2, bit 19 is ADX
+			return ((ebx >> 8) & 1) && ((ebx >> 19) & 1);
+		}();
+		return result;
+	}
+
+	inline uint64 addNBlocks(uint64 *r, const uint64 *a, const uint64 *b, sizeT blocks, uint64 carry) {
+		uint64 n = blocks, t0, t1;
+		asm volatile(
+		"neg %[c]\n\t"
+		"1:\n\t"
+		"mov (%[a]), %[t0]\n\t"
+		"mov 8(%[a]), %[t1]\n\t"
+		"adc (%[b]), %[t0]\n\t"
+		"adc 8(%[b]), %[t1]\n\t"
+		"mov %[t0], (%[r])\n\t"
+		"mov %[t1], 8(%[r])\n\t"
+		"mov 16(%[a]), %[t0]\n\t"
+		"mov 24(%[a]), %[t1]\n\t"
+		"adc 16(%[b]), %[t0]\n\t"
+		"adc 24(%[b]), %[t1]\n\t"
+		"mov %[t0], 16(%[r])\n\t"
+		"mov %[t1], 24(%[r])\n\t"
+		"lea 32(%[a]), %[a]\n\t"
+		"lea 32(%[b]), %[b]\n\t"
+		"lea 32(%[r]), %[r]\n\t"
+		"dec %[n]\n\t"
+		"jnz 1b\n\t"
+		"mov $0, %[c]\n\t"
+		"adc $0, %[c]\n\t"
+		: [r]"+r"(r), [a]"+r"(a), [b]"+r"(b), [n]"+r"(n), [c]"+r"(carry), [t0]"=&r"(t0), [t1]"=&r"(t1)
+		:
+		: "cc", "memory"
+		);
+		return carry;
+	}
+
+	inline uint64 subNBlocks(uint64 *r, const uint64 *a, const uint64 *b, sizeT blocks, uint64 borrow) {
+		uint64 n = blocks, t0, t1;
+		asm volatile(
+		"neg %[c]\n\t"
+		"1:\n\t"
+		"mov (%[a]), %[t0]\n\t"
+		"mov 8(%[a]), %[t1]\n\t"
+		"sbb (%[b]), %[t0]\n\t"
+		"sbb 8(%[b]), %[t1]\n\t"
+		"mov %[t0], (%[r])\n\t"
+		"mov %[t1], 8(%[r])\n\t"
+		"mov 16(%[a]), %[t0]\n\t"
+		"mov 24(%[a]), %[t1]\n\t"
+		"sbb 16(%[b]), %[t0]\n\t"
+		"sbb 24(%[b]), %[t1]\n\t"
+		"mov %[t0], 16(%[r])\n\t"
+		"mov %[t1], 24(%[r])\n\t"
+		"lea 32(%[a]), %[a]\n\t"
+		"lea 32(%[b]), %[b]\n\t"
+		"lea 32(%[r]), %[r]\n\t"
+		"dec %[n]\n\t"
+		"jnz 1b\n\t"
+		"mov $0, %[c]\n\t"
+		"adc $0, %[c]\n\t"
+		: [r]"+r"(r), [a]"+r"(a), [b]"+r"(b), [n]"+r"(n), [c]"+r"(borrow), [t0]"=&r"(t0), [t1]"=&r"(t1)
+		:
+		: "cc", "memory"
+		);
+		return borrow;
+	}
+
+	// products go lo + previous hi through the CF chain, MULX leaves the flags alone
+	inline uint64 mul1Blocks(uint64 *r, const uint64 *a, sizeT blocks, uint64 b, uint64 carry) {
+		uint64 n = blocks, lo, hi;
+		asm volatile(
+		"xor %k[lo], %k[lo]\n\t"
+		"1:\n\t"
+		"mulx (%[a]), %[lo], %[hi]\n\t"
+		"adc %[c], %[lo]\n\t"
+		"mov %[lo], (%[r])\n\t"
+		"mulx 8(%[a]), %[lo], %[c]\n\t"
+		"adc %[hi], %[lo]\n\t"
+		"mov %[lo], 8(%[r])\n\t"
+		"mulx 16(%[a]), %[lo], %[hi]\n\t"
+		"adc %[c], %[lo]\n\t"
+		"mov %[lo], 16(%[r])\n\t"
+		"mulx 24(%[a]), %[lo], %[c]\n\t"
+		"adc %[hi], %[lo]\n\t"
+		"mov %[lo], 24(%[r])\n\t"
+		"lea 32(%[a]), %[a]\n\t"
+		"lea 32(%[r]), %[r]\n\t"
+		"dec %[n]\n\t"
+		"jnz 1b\n\t"
+		"adc $0, %[c]\n\t"
+		: [r]"+r"(r), [a]"+r"(a), [n]"+r"(n), [c]"+r"(carry), [lo]"=&r"(lo), [hi]"=&r"(hi)
+		: "d"(b)
+		: "cc", "memory"
+		);
+		return carry;
+	}
+
+	// two independent carry chains: ADCX adds the previous high half to the product,
+	// ADOX adds the product into r
+	inline uint64 addMul1Blocks(uint64 *r, const uint64 *a, sizeT blocks, uint64 b, uint64 carry) {
+		uint64 n = blocks, lo, hi;
+		asm volatile(
+		"xor %k[lo], %k[lo]\n\t"
+		"1:\n\t"
+		"mulx (%[a]), %[lo], %[hi]\n\t"
+		"adcx %[c], %[lo]\n\t"
+		"adox (%[r]), %[lo]\n\t"
+		"mov %[lo], (%[r])\n\t"
+		"mulx 8(%[a]), %[lo], %[c]\n\t"
+		"adcx %[hi], %[lo]\n\t"
+		"adox 8(%[r]), %[lo]\n\t"
+		"mov %[lo], 8(%[r])\n\t"
+		"mulx 16(%[a]), %[lo], %[hi]\n\t"
+		"adcx %[c], %[lo]\n\t"
+		"adox 16(%[r]), %[lo]\n\t"
+		"mov %[lo], 16(%[r])\n\t"
+		"mulx 24(%[a]), %[lo], %[c]\n\t"
+		"adcx %[hi], %[lo]\n\t"
+		"adox 24(%[r]), %[lo]\n\t"
+		"mov %[lo], 24(%[r])\n\t"
+		"lea 32(%[a]), %[a]\n\t"
+		"lea 32(%[r]), %[r]\n\t"
+		"lea -1(%[n]), %[n]\n\t"
+		"jrcxz 2f\n\t"
+		"jmp 1b\n\t"
+		"2:\n\t"
+		"mov $0, %k[lo]\n\t"
+		"adcx %[lo], %[c]\n\t"
+		"adox %[lo], %[c]\n\t"
+		: [r]"+r"(r), [a]"+r"(a), [n]"+c"(n), [c]"+r"(carry), [lo]"=&r"(lo), [hi]"=&r"(hi)
+		: "d"(b)
+		: "cc", "memory"
+		);
+		return carry;
+	}
+
+	// there is no subtracting ADOX, so r - p is done as r + ~p + 1 with OF starting at 1,
+	// OF = 0 at the end means the low limbs borrowed
+	inline uint64 subMul1Blocks(uint64 *r, const uint64 *a, sizeT blocks, uint64 b, uint64 carry) {
+		uint64 n = blocks, lo, hi;
+		asm volatile(
+		"mov $0x7fffffffffffffff, %[lo]\n\t"
+		"add $1, %[lo]\n\t"
+		"1:\n\t"
+		"mulx (%[a]), %[lo], %[hi]\n\t"
+		"adcx %[c], %[lo]\n\t"
+		"not %[lo]\n\t"
+		"adox (%[r]), %[lo]\n\t"
+		"mov %[lo], (%[r])\n\t"
+		"mulx 8(%[a]), %[lo], %[c]\n\t"
+		"adcx %[hi], %[lo]\n\t"
+		"not %[lo]\n\t"
+		"adox 8(%[r]), %[lo]\n\t"
+		"mov %[lo], 8(%[r])\n\t"
+		"mulx 16(%[a]), %[lo], %[hi]\n\t"
+		"adcx %[c], %[lo]\n\t"
+		"not %[lo]\n\t"
+		"adox 16(%[r]), %[lo]\n\t"
+		"mov %[lo], 16(%[r])\n\t"
+		"mulx 24(%[a]), %[lo], %[c]\n\t"
+		"adcx %[hi], %[lo]\n\t"
+		"not %[lo]\n\t"
+		"adox 24(%[r]), %[lo]\n\t"
+		"mov %[lo], 24(%[r])\n\t"
+		"lea 32(%[a]), %[a]\n\t"
+		"lea 32(%[r]), %[r]\n\t"
+		"lea -1(%[n]), %[n]\n\t"
+		"jrcxz 2f\n\t"
+		"jmp 1b\n\t"
+		"2:\n\t"
+		"mov $0, %k[lo]\n\t"
+		"adcx %[lo], %[c]\n\t"
+		"seto %b[lo]\n\t"
+		: [r]"+r"(r), [a]"+r"(a), [n]"+c"(n), [c]"+r"(carry), [lo]"=&r"(lo), [hi]"=&r"(hi)
+		: "d"(b)
+		: "cc", "memory"
+		);
+		return carry + 1 - lo;
+	}
+
+#endif
+
+	// r = a + b for n limbs each, returns carry
+	inline uint64 addN(uint64 *r, const uint64 *a, const uint64 *b, sizeT n) {
+		uint64 carry = 0;
+#ifdef CPP_LIB_BIG_ASM_KERNELS
+		sizeT blocks = n >> 2, done = blocks << 2;
+		if (blocks) {
+			carry = addNBlocks(r, a, b, blocks, 0);
+			r += done, a += done, b += done, n -= done;
+		}
+#endif
+		return addNPortable(r, a, b, n, carry);
+	}
+
+	// r = a - b for n limbs each, returns borrow
+	inline uint64 subN(uint64 *r, const uint64 *a, const uint64 *b, sizeT n) {
+		uint64 borrow = 0;
+#ifdef CPP_LIB_BIG_ASM_KERNELS
+		sizeT blocks = n >> 2, done = blocks << 2;
+		if (blocks) {
+			borrow = subNBlocks(r, a, b, blocks, 0);
+			r += done, a += done, b += done, n -= done;
+		}
+#endif
+		return subNPortable(r, a, b, n, borrow);
+	}
+
+	// r = a + b where a has n limbs, returns carry
+	inline uint64 add1(uint64 *r, const uint64 *a, sizeT n, uint64 b) {
+		for (sizeT i = 0; i < n; i++) {
+			uint64 cur = a[i] + b;
+			b = cur < b;
+			r[i] = cur;
+		}
+		return b;
+	}
+
+	// r = a - b where a has n limbs, returns borrow
+	inline uint64 sub1(uint64 *r, const uint64 *a, sizeT n, uint64 b) {
+		for (sizeT i = 0; i < n; i++) {
+			uint64 ai = a[i];
+			r[i] = ai - b;
+			b = ai < b;
+		}
+		return b;
+	}
+
+	// r = a + b where a has an limbs, b has bn limbs and an >= bn, returns carry
+	inline uint64 add(uint64 *r, const uint64 *a, sizeT an, const uint64 *b, sizeT bn) {
+		uint64 carry = addN(r, a, b, bn);
+		return add1(r + bn, a + bn, an - bn, carry);
+	}
+
+	// r = a - b where a has an limbs, b has bn limbs and an >= bn, returns borrow
+	inline uint64 sub(uint64 *r, const uint64 *a, sizeT an, const uint64 *b, sizeT bn) {
+		uint64 borrow = subN(r, a, b, bn);
+		return sub1(r + bn, a + bn, an - bn, borrow);
+	}
+
+	// r = a * b for a of n limbs, returns the high limb
+	inline uint64 mul1(uint64 *r, const uint64 *a, sizeT n, uint64 b) {
+		uint64 carry = 0;
+#ifdef CPP_LIB_BIG_ASM_KERNELS
+		sizeT blocks = n >> 2, done = blocks << 2;
+		if (blocks && hasAdx()) {
+			carry = mul1Blocks(r, a, blocks, b, 0);
+			r += done, a += done, n -= done;
+		}
+#endif
+		return mul1Portable(r, a, n, b, carry);
+	}
+
+	// r += a * b for a of n limbs, returns the carry out of r[n - 1]
+	inline uint64 addMul1(uint64 *r, const uint64 *a, sizeT n, uint64 b) {
+		uint64 carry = 0;
+#ifdef CPP_LIB_BIG_ASM_KERNELS
+		sizeT blocks = n >> 2, done = blocks << 2;
+		if (blocks && hasAdx()) {
+			carry = addMul1Blocks(r, a, blocks, b, 0);
+			r += done, a += done, n -= done;
+		}
+#endif
+		return addMul1Portable(r, a, n, b, carry);
+	}
+
+	// r -= a * b for a of n limbs, returns the borrow out of r[n - 1]
+	inline uint64 subMul1(uint64 *r, const uint64 *a, sizeT n, uint64 b) {
+		uint64 carry = 0;
+#ifdef CPP_LIB_BIG_ASM_KERNELS
+		sizeT blocks = n >> 2, done = blocks << 2;
+		if (blocks && hasAdx()) {
+			carry = subMul1Blocks(r, a, blocks, b, 0);
+			r += done, a += done, n -= done;
+		}
+#endif
+		return subMul1Portable(r, a, n, b, carry);
+	}
+
+	// r = a << s for 0 < s < 64, returns the bits shifted out of the top limb
+	inline uint64 shiftLeft(uint64 *r, const uint64 *a, sizeT n, ubyte s) {
+		uint64 out = a[n - 1] >> (64 - s);
+		for (sizeT i = n - 1; i > 0; i--)
+			r[i] = (a[i] << s) | (a[i - 1] >> (64 - s));
+		r[0] = a[0] << s;
+		return out;
+	}
+
+	// r = a >> s for 0 < s < 64, returns the bits shifted out of the bottom limb
+	inline uint64 shiftRight(uint64 *r, const uint64 *a, sizeT n, ubyte s) {
+		uint64 out = a[0] << (64 - s);
+		for (sizeT i = 0; i + 1 < n; i++)
+			r[i] = (a[i] >> s) | (a[i + 1] << (64 - s));
+		r[n - 1] = a[n - 1] >> s;
+		return out;
+	}
+
+	// Schoolbook multiplication, r must hold an + bn limbs and not overlap a or b
+	inline void mulBasecase(uint64 *r, const uint64 *a, sizeT an, const uint64 *b, sizeT bn) {
+		r[an] = mul1(r, a, an, b[0]);
+		for (sizeT i = 1; i < bn; i++)
+			r[an + i] = addMul1(r + i, a, an, b[i]);
+	}
+
+	inline void mul(uint64 *r, const uint64 *a, sizeT an, const uint64 *b, sizeT bn);
+
+	inline void mulBalanced(uint64 *r, const uint64 *a, const uint64 *b, sizeT n, uint64 *scratch);
+
+	inline void nttMul(uint64 *r, const uint64 *a, sizeT an, const uint64 *b, sizeT bn);
+
+	// Scratch space needed by mulBalanced for n-limb operands
+	inline sizeT mulScratchSize(sizeT n) {
+		return 4 * n + 256;
+	}
+
+	// Stores |a - b| in r for n-limb operands, returns 1 if a < b
+	inline ubyte absDiff(uint64 *r, const uint64 *a, const uint64 *b, sizeT n) {
+		if (cmp(a, b, n) < 0) {
+			subN(r, b, a, n);
+			return 1;
+		}
+		subN(r, a, b, n);
+		return 0;
+	}
+
+	// Karatsuba multiplication of two n-limb operands, r gets 2n limbs.
+	// a = a0 + a1*B^l, b = b0 + b1*B^l, where the high halves have h >= l limbs, and
+	// a*b = a0b0 + (a0b0 + a1b1 - (a1-a0)(b1-b0))*B^l + a1b1*B^2l
+	inline void karatsuba(uint64 *r, const uint64 *a, const uint64 *b, sizeT n, uint64 *scratch) {
+		sizeT l = n / 2, h = n - l;
+		uint64 *diffA = r, *diffB = r + h;
+		uint64 *t = scratch, *m = scratch + 2 * h, *next = scratch + 4 * h + 1;
+
+		// |a1 - a0| and |b1 - b0|, the low halves are zero-extended to h limbs
+		ubyte negative = 0;
+		for (ubyte k = 0; k < 2; k++) {
+			const uint64 *x = k ? b : a;
+			uint64 *diff = k ? diffB : diffA;
+			if (h > l && x[n - 1] != 0) {
+				uint64 borrow = subN(diff, x + l, x, l);
+				diff[l] = x[n - 1] - borrow;
+			} else if (h > l) {
+				diff[l] = 0;
+				if (cmp(x + l, x, l) < 0) {
+					subN(diff, x, x + l, l);
+					negative ^= 1;
+				} else {
+					subN(diff, x + l, x, l);
+				}
 			} else {
-				subTwoBigInts(a, 0, b, 0, res);
-				return;
+				negative ^= absDiff(diff, x + l, x, l);
 			}
-		} else if (signb) {
-			subTwoBigInts(a, 0, b, 0, res);
+		}
+		mulBalanced(t, diffA, diffB, h, next);
+
+		mulBalanced(r, a, b, l, next);
+		mulBalanced(r + 2 * l, a + l, b + l, h, next);
+
+		// m = a0b0 + a1b1 -+ t, always fits in 2h + 1 limbs
+		uint64 carry = add(m, r + 2 * l, 2 * h, r, 2 * l);
+		if (negative)
+			carry += addN(m, m, t, 2 * h);
+		else
+			carry -= subN(m, m, t, 2 * h);
+		m[2 * h] = carry;
+
+		add(r + l, r + l, 2 * n - l, m, 2 * h + 1);
+	}
+
+	// Exact division of a W-limb two's complement value by 3
+	inline void divExactBy3(uint64 *r, const uint64 *a, sizeT n) {
+		const uint64 inv3 = 0xAAAAAAAAAAAAAAABULL;
+		uint64 carry = 0;
+		for (sizeT i = 0; i < n; i++) {
+			uint64 ai = a[i];
+			uint64 s = ai - carry;
+			uint64 c1 = ai < carry;
+			uint64 q = s * inv3;
+			r[i] = q;
+			carry = (uint64) (((wide) q * 3) >> 64) + c1;
+		}
+	}
+
+	// Arithmetic shift right by one bit of a W-limb two's complement value
+	inline void halve(uint64 *r, const uint64 *a, sizeT n) {
+		for (sizeT i = 0; i + 1 < n; i++)
+			r[i] = (a[i] >> 1) | (a[i + 1] << 63);
+		r[n - 1] = (uint64) ((int64) a[n - 1] >> 1);
+	}
+
+	inline void negate(uint64 *r, const uint64 *a, sizeT n) {
+		uint64 carry = 1;
+		for (sizeT i = 0; i < n; i++) {
+			uint64 cur = ~a[i] + carry;
+			carry = carry && cur == 0;
+			r[i] = cur;
+		}
+	}
+
+	// Adds a W-limb value into r[0, rn), dropping limbs that must be zero
+	inline void addInto(uint64 *r, sizeT rn, const uint64 *a, sizeT an) {
+		if (an > rn)
+			an = rn;
+		add(r, r, rn, a, an);
+	}
+
+	// Toom-3 multiplication of two n-limb operands, r gets 2n limbs.
+	// Evaluates at 0, 1, -1, -2 and infinity and interpolates with Bodrato's sequence.
+	// Intermediate values are kept in two's complement over w limbs, so the signed
+	// steps are plain additions and subtractions modulo B^w.
+	inline void toom3(uint64 *r, const uint64 *a, const uint64 *b, sizeT n, uint64 *scratch) {
+		sizeT k = (n + 2) / 3, top = n - 2 * k;
+		sizeT e = k + 1, w = 2 * k + 3;
+		Vector<uint64> buffer(6 * e + 5 * w);
+		uint64 *evA = buffer.data(), *evB = evA + 3 * e;
+		uint64 *r1 = evB + 3 * e, *rm1 = r1 + w, *rm2 = rm1 + w, *tmp = rm2 + w, *tmp2 = tmp + w;
+		ubyte signs[3] = {0, 0, 0};
+
+		// p(1), |p(-1)| and |p(-2)| for both operands
+		for (ubyte k2 = 0; k2 < 2; k2++) {
+			const uint64 *x = k2 ? b : a;
+			uint64 *ev = k2 ? evB : evA;
+			uint64 *p1 = ev, *pm1 = ev + e, *pm2 = ev + 2 * e;
+			// p1 = x0 + x2, then pm1 = p1 - x1, p1 += x1
+			p1[k] = add(p1, x, k, x + 2 * k, top);
+			ubyte neg = 0;
+			if (p1[k] == 0 && cmp(p1, x + k, k) < 0) {
+				subN(pm1, x + k, p1, k);
+				pm1[k] = 0;
+				neg = 1;
+			} else {
+				pm1[k] = p1[k] - subN(pm1, p1, x + k, k);
+			}
+			p1[k] += addN(p1, p1, x + k, k);
+			// pm2 = 2*(pm1 + x2) - x0, computed in two's complement over e + 1 limbs
+			uint64 *t = tmp;
+			copy(t, pm1, e);
+			t[e] = 0;
+			if (neg)
+				negate(t, t, e + 1);
+			add(t, t, e + 1, x + 2 * k, top);
+			uint64 hi = 0;
+			for (sizeT i = 0; i <= e; i++) {
+				uint64 cur = t[i];
+				t[i] = (cur << 1) | hi;
+				hi = cur >> 63;
+			}
+			sub(t, t, e + 1, x, k);
+			ubyte neg2 = (t[e] >> 63) != 0;
+			if (neg2)
+				negate(t, t, e + 1);
+			copy(pm2, t, e);
+			signs[1] ^= neg;
+			signs[2] ^= neg2;
+		}
+
+		// pointwise products, r0 and rinf are stored directly in r
+		sizeT topProd = 2 * top;
+		mulBalanced(r, a, b, k, scratch);
+		mul(r + 4 * k, a + 2 * k, top, b + 2 * k, top);
+		for (ubyte i = 0; i < 3; i++) {
+			uint64 *dst = i == 0 ? r1 : (i == 1 ? rm1 : rm2);
+			mulBalanced(dst, evA + i * e, evB + i * e, e, scratch);
+			dst[w - 1] = 0;
+			if (signs[i])
+				negate(dst, dst, w);
+		}
+
+		// widen r0 and rinf to w limbs for interpolation
+		uint64 *r0 = tmp, *rinf = tmp2;
+		copy(r0, r, 2 * k);
+		zero(r0 + 2 * k, w - 2 * k);
+		copy(rinf, r + 4 * k, topProd);
+		zero(rinf + topProd, w - topProd);
+
+		// r3 = (rm2 - r1) / 3
+		subN(rm2, rm2, r1, w);
+		divExactBy3(rm2, rm2, w);
+		// r1 = (r1 - rm1) / 2
+		subN(r1, r1, rm1, w);
+		halve(r1, r1, w);
+		// r2 = rm1 - r0
+		subN(rm1, rm1, r0, w);
+		// r3 = (r2 - r3) / 2 + 2 * rinf
+		subN(rm2, rm1, rm2, w);
+		halve(rm2, rm2, w);
+		addN(rm2, rm2, rinf, w);
+		addN(rm2, rm2, rinf, w);
+		// r2 = r2 + r1 - rinf
+		addN(rm1, rm1, r1, w);
+		subN(rm1, rm1, rinf, w);
+		// r1 = r1 - r3
+		subN(r1, r1, rm2, w);
+
+		// r already holds r0 and rinf in disjoint slots, clear the gap and add the rest
+		zero(r + 2 * k, 2 * k);
+		addInto(r + k, 2 * n - k, r1, w);
+		addInto(r + 2 * k, 2 * n - 2 * k, rm1, w);
+		addInto(r + 3 * k, 2 * n - 3 * k, rm2, w);
+	}
+
+	// Multiplications whose transforms have at least parallelNttThreshold points run on the
+	// pool set with BigInt::setThreadPool, split into tasks of parallelChunk butterflies
+	const sizeT parallelNttThreshold = 1 << 16;
+
+	inline ThreadPool *&multiplyPool() {
+		static ThreadPool *pool = nullptr;
+		return pool;
+	}
+
+	// Multiplication through cyclic convolutions modulo three primes, r must hold an + bn limbs.
+	// Every convolution coefficient is below min(an, bn) * 2^128, so Garner's CRT over
+	// p0 * p1 * p2 (about 2^183) recovers it exactly. Squaring transforms the operand only once.
+	// With a thread pool the three primes are transformed at the same time, each stage of a
+	// transform is split over the pool, and the CRT runs on pieces whose carries are added last
+	inline void nttMul(uint64 *r, const uint64 *a, sizeT an, const uint64 *b, sizeT bn) {
+		bool square = a == b && an == bn;
+		sizeT len = an + bn - 1;
+		sizeT n = 1;
+		while (n < len)
+			n <<= 1;
+		ThreadPool *pool = n >= parallelNttThreshold ? multiplyPool() : nullptr;
+		// every prime gets its own buffers when they run in parallel
+		sizeT copies = pool != nullptr ? 3 : 1;
+		Vector<uint64> residues(3 * n), other(square ? 0 : copies * n), roots(copies * n), rootsShoup(copies * n);
+
+		auto transform = [&](sizeT k) {
+			const NttPrime &m = nttPrime(k);
+			sizeT buffer = copies == 3 ? k * n : 0;
+			uint64 *fa = residues.data() + k * n, *fb = other.data() + (square ? 0 : buffer);
+			uint64 *w = roots.data() + buffer, *wShoup = rootsShoup.data() + buffer;
+			nttConvolve(fa, a, an, square ? nullptr : b, bn, n, len, fb, w, wShoup, m, pool);
+		};
+		if (pool != nullptr) {
+			pool->parallelFor(3, transform);
+		} else {
+			for (ubyte k = 0; k < 3; k++)
+				transform(k);
+		}
+
+		const NttPrime &m0 = nttPrime(0), &m1 = nttPrime(1), &m2 = nttPrime(2);
+		uint64 p0 = m0.p, p1 = m1.p;
+		uint64 inv01 = m1.pow(m1.toMont(p0), m1.p - 2);
+		uint64 inv012 = m2.pow(m2.mul(m2.toMont(p0), m2.toMont(p1)), m2.p - 2);
+		uint64 p0Mod2 = m2.toMont(p0);
+		wide p01 = (wide) p0 * p1;
+		uint64 p01Low = (uint64) p01, p01High = (uint64) (p01 >> 64);
+		const uint64 *x0 = residues.data(), *x1 = x0 + n, *x2 = x1 + n;
+
+		// writes r[lo, hi) and returns the two limbs carried out of r[hi - 1]
+		auto garner = [&](sizeT lo, sizeT hi, uint64 *carry) {
+			uint64 c0 = 0, c1 = 0;
+			for (sizeT i = lo; i < hi; i++) {
+				// x = v0 + v1*p0 + v2*p0*p1 with v0 < p0, v1 < p1, v2 < p2,
+				// added to the running carry which always fits in two limbs
+				uint64 v0 = x0[i];
+				uint64 v1 = m1.mul(m1.sub(x1[i], v0 >= p1 ? v0 - p1 : v0), inv01);
+				uint64 v0Mod2 = v0 >= m2.p ? v0 - m2.p : v0;
+				v0Mod2 = v0Mod2 >= m2.p ? v0Mod2 - m2.p : v0Mod2;
+				uint64 v2 = m2.sub(m2.sub(x2[i], v0Mod2), m2.mul(v1 >= m2.p ? v1 - m2.p : v1, p0Mod2));
+				v2 = m2.mul(v2, inv012);
+
+				wide low = (wide) v1 * p0 + v0;
+				wide mid = (wide) v2 * p01Low;
+				wide high = (wide) v2 * p01High;
+				wide acc = (wide) (uint64) low + (uint64) mid + c0;
+				r[i] = (uint64) acc;
+				acc = (acc >> 64) + (uint64) (low >> 64) + (uint64) (mid >> 64) + (uint64) high + c1;
+				c0 = (uint64) acc;
+				c1 = (uint64) (acc >> 64) + (uint64) (high >> 64);
+			}
+			carry[0] = c0, carry[1] = c1;
+		};
+		if (pool == nullptr || len <= parallelChunk) {
+			uint64 carry[2];
+			garner(0, len, carry);
+			r[len] = carry[0];
 			return;
 		}
-		ubyte carry = 0, extra;
-		uint32 end = Algorithm::max(*a->size, *b->size);
-		res->_data.resize(end + 1);
-		for (int32 i = 0; i < end || carry; i++) {
-			extra = carry;
-			carry = 0;
-			res->_data[i] = add64(
-				i < *a->size ? a->_data[i] : 0ULL,
-				i < *b->size ? b->_data[i] : 0ULL,
-				&carry);
-			if (extra) {
-				res->_data[i] += 1ULL;
-				if (res->_data[i] == 0ULL) carry = 1;
+		sizeT pieces = (len + parallelChunk - 1) / parallelChunk;
+		Vector<uint64> carries(2 * pieces);
+		pool->parallelFor(pieces, [&](sizeT i) {
+			garner(i * parallelChunk, Algorithm::min(len, (i + 1) * parallelChunk), carries.data() + 2 * i);
+		});
+		// the pieces are summed into r one after the other, a carry rarely runs far
+		r[len] = 0;
+		for (sizeT i = 0; i < pieces; i++) {
+			sizeT at = Algorithm::min(len, (i + 1) * parallelChunk);
+			wide acc = (wide) r[at] + carries[2 * i];
+			r[at] = (uint64) acc;
+			uint64 carry = (uint64) (acc >> 64) + carries[2 * i + 1];
+			while (carry != 0 && ++at <= len) {
+				acc = (wide) r[at] + carry;
+				r[at] = (uint64) acc;
+				carry = (uint64) (acc >> 64);
 			}
 		}
-		if (res->_data[*res->size - 1] == 0) res->_data.resize(*res->size - 1);
 	}
 
-	void subTwoBigInts(const BigInt *a, ubyte signa, const BigInt *b, ubyte signb, BigInt *res) {
-		res->sign = 0;
-		if (signa) {
-			if (!signb) {
-				addTwoBigInts(a, 1, b, 1, res);
-				return;
+	// Multiplies two n-limb operands using the algorithm suited for their size
+	inline void mulBalanced(uint64 *r, const uint64 *a, const uint64 *b, sizeT n, uint64 *scratch) {
+		if (n >= nttThreshold)
+			nttMul(r, a, n, b, n);
+		else if (n < karatsubaThreshold)
+			mulBasecase(r, a, n, b, n);
+		else if (n < toom3Threshold)
+			karatsuba(r, a, b, n, scratch);
+		else
+			toom3(r, a, b, n, scratch);
+	}
+
+	// General multiplication, r must hold an + bn limbs and not overlap a or b.
+	// Unbalanced operands are cut into bn-limb pieces of a, each multiplied as a balanced product.
+	inline void mul(uint64 *r, const uint64 *a, sizeT an, const uint64 *b, sizeT bn) {
+		if (an < bn) {
+			Algorithm::swap(a, b);
+			Algorithm::swap(an, bn);
+		}
+		if (bn == 0)
+			return;
+		if (bn < karatsubaThreshold) {
+			mulBasecase(r, a, an, b, bn);
+			return;
+		}
+		if (bn >= nttThreshold) {
+			nttMul(r, a, an, b, bn);
+			return;
+		}
+		Vector<uint64> scratch(mulScratchSize(bn) + 2 * bn);
+		if (an == bn) {
+			mulBalanced(r, a, b, bn, scratch.data());
+			return;
+		}
+		uint64 *piece = scratch.data() + mulScratchSize(bn);
+		zero(r, an + bn);
+		for (sizeT offset = 0; offset < an; offset += bn) {
+			sizeT len = Algorithm::min(bn, an - offset);
+			if (len == bn)
+				mulBalanced(piece, a + offset, b, bn, scratch.data());
+			else
+				mul(piece, b, bn, a + offset, len);
+			add(r + offset, r + offset, an + bn - offset, piece, len + bn);
+		}
+	}
+
+	// Quotient sizes (in limbs) from which division recurses instead of running Knuth's algorithm D
+	const sizeT burnikelZieglerThreshold = 48;
+
+	// Divides a of n limbs by a single limb, q gets n limbs, returns the remainder
+	inline uint64 divRem1(uint64 *q, const uint64 *a, sizeT n, uint64 d) {
+		ubyte s = __builtin_clzll(d);
+		d <<= s;
+		uint64 recip = getNormalizedReciprocal64(d);
+		uint64 rem = s ? a[n - 1] >> (64 - s) : 0;
+		for (sizeT i = n; i-- > 0;) {
+			uint64 cur = a[i] << s;
+			if (s && i > 0)
+				cur |= a[i - 1] >> (64 - s);
+			uint128 res = div128by64UsingRecip({rem, cur}, d, recip);
+			q[i] = res.a;
+			rem = res.b;
+		}
+		return rem >> s;
+	}
+
+	// Knuth's algorithm D. Divides u of un limbs by normalized d of dn >= 2 limbs,
+	// q gets un - dn limbs, the remainder is left in u[0, dn). Returns the extra top
+	// quotient limb, which is 1 if the top dn limbs of u were not below d
+	inline uint64 divSchool(uint64 *q, uint64 *u, sizeT un, const uint64 *d, sizeT dn, uint64 recip) {
+		uint64 qh = 0;
+		if (cmp(u + un - dn, d, dn) >= 0) {
+			subN(u + un - dn, u + un - dn, d, dn);
+			qh = 1;
+		}
+		uint64 d1 = d[dn - 1], d0 = d[dn - 2];
+		for (sizeT j = un - dn; j-- > 0;) {
+			uint64 n2 = u[j + dn], n1 = u[j + dn - 1], n0 = u[j + dn - 2];
+			uint64 qhat, rhat;
+			bool overflow = false;
+			if (n2 == d1) {
+				// (n2, n1) / d1 doesn't fit in a limb, start from B - 1
+				qhat = ~0ULL;
+				rhat = n1 + d1;
+				overflow = rhat < d1;
 			} else {
+				uint128 est = div128by64UsingRecip({n2, n1}, d1, recip);
+				qhat = est.a;
+				rhat = est.b;
+			}
+			// refine with the second divisor limb, qhat ends up at most one too big
+			while (!overflow && (wide) qhat * d0 > (((wide) rhat << 64) | n0)) {
+				qhat--;
+				rhat += d1;
+				overflow = rhat < d1;
+			}
+			uint64 borrow = subMul1(u + j, d, dn, qhat);
+			if (borrow > n2) {
+				qhat--;
+				addN(u + j, u + j, d, dn);
+			}
+			u[j + dn] = 0;
+			q[j] = qhat;
+		}
+		return qh;
+	}
+
+	// Burnikel-Ziegler recursive division. Divides u of dn + qn limbs by normalized d of dn
+	// limbs with qn <= dn, q gets qn limbs and the remainder is left in u[0, dn).
+	// A 2n/n division is split into two 3n/2 by n divisions, each of which divides by the
+	// top half of d recursively and corrects the estimate with one multiplication.
+	// scratch must hold dn limbs. Returns the extra top quotient limb like divSchool
+	inline uint64 divRecursive(uint64 *q, uint64 *u, const uint64 *d, sizeT dn, sizeT qn, uint64 recip, uint64 *scratch) {
+		if (qn < burnikelZieglerThreshold)
+			return divSchool(q, u, dn + qn, d, dn, recip);
+		if (qn == dn) {
+			sizeT lo = dn / 2, hi = dn - lo;
+			uint64 qh = divRecursive(q + lo, u + lo, d, dn, hi, recip, scratch);
+			divRecursive(q, u, d, dn, lo, recip, scratch);
+			return qh;
+		}
+		// divide the top 2qn limbs of u by the top qn limbs of d
+		sizeT lowSize = dn - qn;
+		uint64 qh = divRecursive(q, u + lowSize, d + lowSize, qn, qn, recip, scratch);
+		// subtract the part of q*d contributed by the low limbs of d
+		mul(scratch, q, qn, d, lowSize);
+		uint64 borrow = subN(u, u, scratch, dn);
+		if (qh)
+			borrow += subN(u + qn, u + qn, d, lowSize);
+		while (borrow) {
+			qh -= sub1(q, q, qn, 1);
+			borrow -= addN(u, u, d, dn);
+		}
+		return qh;
+	}
+
+	// Divides a of an limbs by d of dn limbs (an >= dn, top limb of d not zero),
+	// q gets an - dn + 1 limbs and r gets dn limbs
+	inline void divRem(uint64 *q, uint64 *r, const uint64 *a, sizeT an, const uint64 *d, sizeT dn) {
+		if (dn == 1) {
+			r[0] = divRem1(q, a, an, d[0]);
+			return;
+		}
+		// normalize so the top bit of the divisor is set, u gets one extra limb.
+		// Small divisions work on the stack so they don't allocate, large ones
+		// free their buffer even when the recursion throws
+		ubyte s = __builtin_clzll(d[dn - 1]);
+		sizeT bufferSize = an + 1 + 2 * dn;
+		uint64 stackBuffer[64];
+		std::unique_ptr<uint64[]> heapBuffer(bufferSize > 64 ? new uint64[bufferSize] : nullptr);
+		uint64 *u = heapBuffer ? heapBuffer.get() : stackBuffer;
+		uint64 *dd = u + an + 1, *scratch = dd + dn;
+		if (s) {
+			shiftLeft(dd, d, dn, s);
+			u[an] = shiftLeft(u, a, an, s);
+		} else {
+			copy(dd, d, dn);
+			copy(u, a, an);
+			u[an] = 0;
+		}
+		uint64 recip = getNormalizedReciprocal64(dd[dn - 1]);
+
+		// the top dn limbs of u are below dd, so take quotient blocks of at most dn limbs
+		// from the top, the remainder of one block is the top of the next one
+		sizeT qn = an + 1 - dn;
+		while (qn > 0) {
+			sizeT block = qn % dn == 0 ? dn : qn % dn;
+			qn -= block;
+			divRecursive(q + qn, u + qn, dd, dn, block, recip, scratch);
+		}
+
+		if (s)
+			shiftRight(r, u, dn, s);
+		else
+			copy(r, u, dn);
+	}
+
+	// Numbers with at least this many limbs to remove are reduced by the half-gcd recursion
+	// on their leading limbs, shorter ones by Lehmer steps
+	const sizeT halfGcdThreshold = 64;
+
+	// Binary gcd of two words
+	inline uint64 gcd1(uint64 a, uint64 b) {
+		if (a == 0 || b == 0)
+			return a | b;
+		ubyte shift = __builtin_ctzll(a | b);
+		a >>= __builtin_ctzll(a);
+		while (b) {
+			b >>= __builtin_ctzll(b);
+			if (a > b)
 				Algorithm::swap(a, b);
+			b -= a;
+		}
+		return a << shift;
+	}
+
+	// Lehmer's step (Knuth 4.5.2, algorithm L). x >= y are the leading 62 bits of two numbers
+	// taken at the same shift. Runs Euclid on them for as long as the quotients are certain to
+	// match the quotients of the full numbers and stores the cofactors (A B; C D) in m, so that
+	// (A a + B b, C a + D b) are two consecutive remainders of a and b. m[1] == 0 means no
+	// quotient could be trusted and the caller has to divide
+	inline void lehmerMatrix(uint64 x, uint64 y, int64 *m) {
+		int64 u = x, v = y, a = 1, b = 0, c = 0, d = 1;
+		while (v + c > 0 && v + d > 0) {
+			int64 q = (u + a) / (v + c);
+			if (q == 0 || q != (u + b) / (v + d))
+				break;
+			int64 t = a - q * c;
+			a = c, c = t;
+			t = b - q * d;
+			b = d, d = t;
+			t = u - q * v;
+			u = v, v = t;
+		}
+		m[0] = a, m[1] = b, m[2] = c, m[3] = d;
+	}
+
+	// Conversion between limbs and decimal digits. Both directions split the number by
+	// powers 10^(18 * 2^k), computed once per conversion, and recurse on the halves,
+	// so they cost O(M(n) log n) instead of O(n^2)
+	const uint64 decimalBase = 1000000000000000000ULL;
+	const sizeT decimalDigits = 18;
+	// Numbers of at most this many 18-digit chunks are converted one chunk at a time
+	const sizeT radixThreshold = 32;
+
+	// Upper bound of limbs needed for a number of len decimal digits, len * log2(10) / 64 + 2
+	inline sizeT decimalLimbs(sizeT len) {
+		return (sizeT) (len * 0.0519051265) + 2;
+	}
+
+	// powers[k] = 10^(18 * 2^k) for every k with 2^k < chunks
+	inline void decimalPowers(Vector<Vector<uint64>> &powers, sizeT chunks) {
+		powers.push(Vector<uint64>(1, decimalBase));
+		for (sizeT k = 1; ((sizeT) 1 << k) < chunks; k++) {
+			const Vector<uint64> &prev = powers[k - 1];
+			sizeT n = *prev.size;
+			Vector<uint64> next(2 * n);
+			mul(next.data(), prev.data(), n, prev.data(), n);
+			if (next.back() == 0)
+				next.resize(2 * n - 1);
+			powers.push(next);
+		}
+	}
+
+	// Writes exactly 18 * chunks digits of a, padded with leading zeros, a must be below 10^(18 * chunks)
+	inline void toDecimal(const uint64 *a, sizeT n, char32_t *out, sizeT chunks, const Vector<Vector<uint64>> &powers) {
+		while (n > 0 && a[n - 1] == 0)
+			n--;
+		if (chunks <= radixThreshold) {
+			Vector<uint64> rest(n);
+			uint64 *cur = rest.data();
+			copy(cur, a, n);
+			for (sizeT c = chunks; c-- > 0;) {
+				uint64 chunk = n > 0 ? divRem1(cur, cur, n, decimalBase) : 0;
+				while (n > 0 && cur[n - 1] == 0)
+					n--;
+				for (sizeT i = decimalDigits; i-- > 0;) {
+					out[c * decimalDigits + i] = U'0' + chunk % 10;
+					chunk /= 10;
+				}
 			}
-		} else if (signb) {
-			addTwoBigInts(a, 0, b, 0, res);
 			return;
 		}
-		if (a->operator<(*b)) {
-			res->sign = 1;
+		// the low part takes the largest power of two chunks below the total
+		sizeT k = 0;
+		while (((sizeT) 2 << k) < chunks)
+			k++;
+		sizeT lowChunks = (sizeT) 1 << k, highChunks = chunks - lowChunks;
+		char32_t *lowOut = out + highChunks * decimalDigits;
+		const Vector<uint64> &power = powers[k];
+		sizeT pn = *power.size;
+		if (n < pn) {
+			Algorithm::fill(out, lowOut, U'0');
+			toDecimal(a, n, lowOut, lowChunks, powers);
+			return;
+		}
+		Vector<uint64> q(n - pn + 1), r(pn);
+		divRem(q.data(), r.data(), a, n, power.data(), pn);
+		toDecimal(q.data(), n - pn + 1, out, highChunks, powers);
+		toDecimal(r.data(), pn, lowOut, lowChunks, powers);
+	}
+
+	inline uint64 digitValue(char32_t c) {
+		if (c < U'0' || c > U'9')
+			throw std::runtime_error("Cannot convert unnumeric string to BigInt.");
+		return c - U'0';
+	}
+
+	// Reads len decimal digits into r, which must hold decimalLimbs(len) limbs, returns the used size
+	inline sizeT fromDecimal(uint64 *r, const char32_t *digits, sizeT len, const Vector<Vector<uint64>> &powers) {
+		sizeT chunks = (len + decimalDigits - 1) / decimalDigits;
+		sizeT n = 0;
+		if (chunks <= radixThreshold) {
+			sizeT chunkLen = len - decimalDigits * (chunks - 1);
+			for (sizeT c = 0; c < chunks; c++, chunkLen = decimalDigits) {
+				uint64 chunk = 0;
+				for (sizeT i = 0; i < chunkLen; i++)
+					chunk = chunk * 10 + digitValue(*digits++);
+				uint64 carry = mul1(r, r, n, decimalBase);
+				if (carry)
+					r[n++] = carry;
+				// with n == 0 add1 hands the chunk back as the carry
+				carry = add1(r, r, n, chunk);
+				if (carry)
+					r[n++] = carry;
+			}
+		} else {
+			// high * 10^(18 * 2^k) + low with the same split as toDecimal
+			sizeT k = 0;
+			while (((sizeT) 2 << k) < chunks)
+				k++;
+			sizeT lowLen = decimalDigits << k, highLen = len - lowLen;
+			Vector<uint64> high(decimalLimbs(highLen)), low(decimalLimbs(lowLen));
+			sizeT hn = fromDecimal(high.data(), digits, highLen, powers);
+			sizeT ln = fromDecimal(low.data(), digits + highLen, lowLen, powers);
+			const Vector<uint64> &power = powers[k];
+			if (hn > 0) {
+				n = hn + *power.size;
+				mul(r, high.data(), hn, power.data(), *power.size);
+			}
+			if (n < ln) {
+				copy(r, low.data(), ln);
+				n = ln;
+			} else if (add(r, r, n, low.data(), ln)) {
+				r[n++] = 1;
+			}
+		}
+		while (n > 0 && r[n - 1] == 0)
+			n--;
+		return n;
+	}
+}
+
+// Limb storage for BigInt with a small-buffer optimization: numbers of up to _inlineSize
+// limbs live inside the object, larger ones spill to the heap, growing in powers of 2 like Vector.
+// Copies and moves keep small numbers inline, so BigInts of a few words never allocate
+
+class LimbStorage {
+	static const sizeT _inlineSize = 4;
+	uint64 _inline[_inlineSize];
+	uint64 *_limbs = _inline;
+	sizeT _currentSize = 0;
+	sizeT _currentMaxSize = _inlineSize;
+
+	void assign(const uint64 *limbs, sizeT n) {
+		resize(n);
+		Limbs::copy(_limbs, limbs, n);
+	}
+
+	void release() {
+		// a maximum size of 0 marks limbs borrowed from memory the storage doesn't own
+		if (_limbs != _inline && _currentMaxSize != 0)
+			delete[] _limbs;
+		_limbs = _inline;
+		_currentMaxSize = _inlineSize;
+	}
+
+	// takes over the heap array of other, or copies its inline limbs
+	void take(LimbStorage &other) {
+		if (other._limbs == other._inline) {
+			_currentSize = 0;
+			assign(other._inline, other._currentSize);
+		} else {
+			_limbs = other._limbs;
+			_currentSize = other._currentSize;
+			_currentMaxSize = other._currentMaxSize;
+			other._limbs = other._inline;
+			other._currentMaxSize = _inlineSize;
+		}
+		other._currentSize = 0;
+	}
+
+public:
+	const sizeT *size = &_currentSize;
+
+	LimbStorage() {}
+
+	LimbStorage(const LimbStorage &other) {
+		assign(other._limbs, other._currentSize);
+	}
+
+	LimbStorage(LimbStorage &&other) noexcept {
+		take(other);
+	}
+
+	~LimbStorage() {
+		release();
+	}
+
+	LimbStorage &operator=(const LimbStorage &other) {
+		if (this != &other)
+			assign(other._limbs, other._currentSize);
+		return *this;
+	}
+
+	LimbStorage &operator=(LimbStorage &&other) noexcept {
+		if (this != &other) {
+			release();
+			take(other);
+		}
+		return *this;
+	}
+
+	uint64 &operator[](sizeT index) const {
+		if (index >= _currentSize) throw std::runtime_error("Accessing limb at invalid location in BigInt.");
+		return _limbs[index];
+	}
+
+	uint64 at(sizeT index) const {
+		return operator[](index);
+	}
+
+	uint64 back() const {
+		return _limbs[_currentSize - 1];
+	}
+
+	uint64 *data() const {
+		return _limbs;
+	}
+
+	bool operator==(const LimbStorage &other) const {
+		return _currentSize == other._currentSize && Limbs::cmp(_limbs, other._limbs, _currentSize) == 0;
+	}
+
+	// Points the storage at n limbs owned by someone else, for read-only views.
+	// The limbs are copied as soon as the storage is resized
+	void borrow(const uint64 *limbs, sizeT n) {
+		release();
+		_limbs = const_cast<uint64 *>(limbs);
+		_currentSize = n;
+		_currentMaxSize = 0;
+	}
+
+	// grows with zeros, shrinking keeps the allocation
+	void resize(sizeT t_n) {
+		if (_currentMaxSize == 0) {
+			const uint64 *borrowed = _limbs;
+			sizeT n = _currentSize;
+			_limbs = _inline;
+			_currentMaxSize = _inlineSize;
+			_currentSize = 0;
+			assign(borrowed, Algorithm::min(n, t_n));
+		}
+		if (t_n > _currentMaxSize) {
+			sizeT newMaxSize = Math::roundToNextPowerOfTwo(t_n);
+			uint64 *tmpArray = new uint64[newMaxSize];
+			Limbs::copy(tmpArray, _limbs, _currentSize);
+			release();
+			_limbs = tmpArray;
+			_currentMaxSize = newMaxSize;
+		}
+		if (t_n > _currentSize)
+			Limbs::zero(_limbs + _currentSize, t_n - _currentSize);
+		_currentSize = t_n;
+	}
+
+	// makes room for t_n limbs without changing the size
+	void reserve(sizeT t_n) {
+		if (t_n > _currentMaxSize) {
+			sizeT oldSize = _currentSize;
+			resize(t_n);
+			_currentSize = oldSize;
+		}
+	}
+
+	void push(uint64 t_value) {
+		resize(_currentSize + 1);
+		_limbs[_currentSize - 1] = t_value;
+	}
+
+	void pop() {
+		if (_currentSize == 0) throw std::runtime_error("Trying to pop limb from empty BigInt.");
+		_currentSize--;
+	}
+};
+
+class BigIntView;
+
+class BigInt {
+private:
+	// works on the limbs directly for its mantissas
+	friend class BigFloat;
+
+	static const uint64 _cellMax = 0xffffffffffffffffULL;
+	LimbStorage _data;
+
+	void removeLeadingZeros() {
+		while (*size && _data.back() == 0)
+			_data.pop();
+		if (*size == 0)
+			sign = 0;
+	}
+
+	// res = a + b where a and b are taken with the signs signa and signb,
+	// res may be the same object as a or b
+	static void addTwoBigInts(const BigInt *a, ubyte signa, const BigInt *b, ubyte signb, BigInt *res) {
+		sizeT an = *a->size, bn = *b->size;
+		if (an < bn) {
 			Algorithm::swap(a, b);
+			Algorithm::swap(an, bn);
+			Algorithm::swap(signa, signb);
+		}
+		if (signa == signb) {
+			res->_data.resize(an + 1);
+			// the pointers are taken after the resize, res may be one of the operands
+			uint64 *r = res->_data.data();
+			r[an] = Limbs::add(r, a->_data.data(), an, b->_data.data(), bn);
+			res->sign = signa;
+			res->removeLeadingZeros();
+			return;
 		}
-		res->_data.resize(*a->size);
-		ubyte borrow = 0, extra;
-		int32 i = 0;
-		for (; i < *b->size || borrow; i++) {
-			extra = borrow;
-			borrow = 0;
-			res->_data[i] = sub64(a->_data[i], i < *b->size ? b->_data[i] : 0ULL, &borrow);
-			if (extra) {
-				res->_data[i] -= 1ULL;
-				if (res->_data[i] == _cellMax) borrow = 1;
+		// different signs, the result is the difference of the magnitudes
+		// and takes the sign of the larger one
+		if (an == bn) {
+			int order = Limbs::cmp(a->_data.data(), b->_data.data(), an);
+			if (order == 0) {
+				res->_data.resize(0);
+				res->sign = 0;
+				return;
+			}
+			if (order < 0) {
+				Algorithm::swap(a, b);
+				Algorithm::swap(signa, signb);
 			}
 		}
-		for (; i < *a->size; i++)
-			res->_data[i] = a->_data[i];
+		res->_data.resize(an);
+		uint64 *r = res->_data.data();
+		Limbs::sub(r, a->_data.data(), an, b->_data.data(), bn);
+		res->sign = signa;
 		res->removeLeadingZeros();
 	}
 
-	void multTwoBigInts(const BigInt *a, ubyte signa, const BigInt *b, ubyte signb, BigInt *res) {
-		res->sign = 0;
-		if (signa ^ signb)
-			res->sign = 1;
-		res->resize(*a->size + *b->size);
-		uint128 cur;
-		for (int32 i = 0; i < *a->size; i++) {
-			uint64 carry = 0;
-			for (int32 j = 0; j < *b->size || carry; j++) {
-				cur = mult64(a->_data[i], j < *b->size ? b->_data[j] : 0ULL);
-				cur = add64to128(cur, res->_data[i + j]);
-				cur = add64to128(cur, carry);
-				res->_data[i + j] = cur.b;
-				carry = cur.a;
-			}
+	static void subTwoBigInts(const BigInt *a, ubyte signa, const BigInt *b, ubyte signb, BigInt *res) {
+		addTwoBigInts(a, signa, b, signb ^ 1, res);
+	}
+
+	static void multTwoBigInts(const BigInt *a, ubyte signa, const BigInt *b, ubyte signb, BigInt *res) {
+		sizeT an = *a->size, bn = *b->size;
+		if (an == 0 || bn == 0) {
+			res->_data.resize(0);
+			res->sign = 0;
+			return;
 		}
+		// the product can't be written over one of its operands. One spare limb
+		// lets a following addition reuse its storage without growing it
+		LimbStorage product;
+		product.reserve(an + bn + 1);
+		product.resize(an + bn);
+		Limbs::mul(product.data(), a->_data.data(), an, b->_data.data(), bn);
+		res->_data = std::move(product);
+		res->sign = signa ^ signb;
 		res->removeLeadingZeros();
 	}
 
@@ -195,7 +1340,7 @@ private:
 	// IF YOU NEED PROPER MODULO, CONVERT UINT64 TO BIGINT AND THEN DIVIDE
 	// IF DIVIDING BY INT64 (SIGNED) THE MODULO RESULT WILL BE CORRECT
 
-	uint64 divByUInt64(const BigInt *a, ubyte signa, uint64 b, ubyte signb, BigInt *res) {
+	static uint64 divByUInt64(const BigInt *a, ubyte signa, uint64 b, ubyte signb, BigInt *res) {
 		ubyte ressign = 0;
 		if (b == 0) {
 			throw std::runtime_error("Can't divide BigInt by zero.");
@@ -224,24 +1369,369 @@ private:
 			return carry;
 	}
 
-	void multByUInt64(const BigInt *a, ubyte signa, uint64 b, ubyte signb, BigInt *res) {
-		ubyte ressign = 0;
-		if (signa ^ signb)
-			ressign = 1;
-		uint64 carry = 0;
-		res->_data.resize(*a->size);
-		for (int32 i = 0; i < *a->size || carry; i++) {
-			if (i == *a->size)
-				res->_data.push(0);
-			uint128 cur = mult64(a->_data[i], b);
-			cur = add64to128(cur, carry);
-			carry = cur.a;
-			res->_data[i] = cur.b;
-		}
-		res->sign = ressign;
+	// divides BigInt a by BigInt b, storing the quotient in quot and the remainder in rem,
+	// either of which may be nullptr. The quotient is truncated towards zero and the
+	// remainder takes the sign of a, like the built-in integer division
+	static void divTwoBigInts(const BigInt *a, ubyte signa, const BigInt *b, ubyte signb, BigInt *quot, BigInt *rem) {
+		sizeT an = *a->size, bn = *b->size;
+		if (bn == 0) {
+			throw std::runtime_error("Can't divide BigInt by zero.");
+		}
+		if (an < bn || (an == bn && Limbs::cmp(a->_data.data(), b->_data.data(), an) < 0)) {
+			if (rem != nullptr && rem != a) {
+				rem->_data = a->_data;
+				rem->sign = signa;
+			}
+			if (quot != nullptr) {
+				quot->_data.resize(0);
+				quot->sign = 0;
+			}
+			return;
+		}
+		LimbStorage q, r;
+		q.resize(an - bn + 1);
+		r.resize(bn);
+		Limbs::divRem(q.data(), r.data(), a->_data.data(), an, b->_data.data(), bn);
+		if (quot != nullptr) {
+			quot->_data = std::move(q);
+			quot->sign = signa ^ signb;
+			quot->removeLeadingZeros();
+		}
+		if (rem != nullptr) {
+			rem->_data = std::move(r);
+			rem->sign = signa;
+			rem->removeLeadingZeros();
+		}
+	}
+
+	// b is the magnitude of the multiplier and signb its sign
+	static void multByUInt64(const BigInt *a, ubyte signa, uint64 b, ubyte signb, BigInt *res) {
+		sizeT an = *a->size;
+		res->_data.resize(an + 1);
+		uint64 *r = res->_data.data();
+		r[an] = Limbs::mul1(r, a->_data.data(), an, b);
+		res->sign = signa ^ signb;
+		res->removeLeadingZeros();
+	}
+
+	// res += a * b where b is the magnitude of a word multiplier and signb its sign,
+	// done in place on the limbs of res. res may be the same object as a
+	static void addMulUInt64(const BigInt *a, ubyte signa, uint64 b, ubyte signb, BigInt *res) {
+		sizeT an = *a->size, rn = *res->size;
+		if (an == 0 || b == 0)
+			return;
+		ubyte signp = signa ^ signb;
+		if (rn == 0)
+			res->sign = signp;
+		sizeT n = Algorithm::max(an, rn) + 1;
+		res->_data.resize(n);
+		uint64 *r = res->_data.data();
+		if (res->sign == signp) {
+			uint64 carry = Limbs::addMul1(r, a->_data.data(), an, b);
+			Limbs::add1(r + an, r + an, n - an, carry);
+		} else {
+			uint64 borrow = Limbs::subMul1(r, a->_data.data(), an, b);
+			// the product was larger than res, the limbs hold its two's complement
+			if (Limbs::sub1(r + an, r + an, n - an, borrow)) {
+				Limbs::negate(r, r, n);
+				res->sign = signp;
+			}
+		}
 		res->removeLeadingZeros();
 	}
 
+	// res += a * b with the signs signa and signb, a and b may be the same object as res.
+	// The word factor is read before res changes
+	static void addMulTwoBigInts(const BigInt *a, ubyte signa, const BigInt *b, ubyte signb, BigInt *res) {
+		if (*b->size == 1) {
+			addMulUInt64(a, signa, b->_data[0], signb, res);
+			return;
+		}
+		if (*a->size == 1) {
+			addMulUInt64(b, signb, a->_data[0], signa, res);
+			return;
+		}
+		BigInt product;
+		multTwoBigInts(a, signa, b, signb, &product);
+		addTwoBigInts(res, res->sign, &product, product.sign, res);
+	}
+
+	// The gcd helpers keep a >= b >= 0 and, when w isn't nullptr, the rows of the matrix w
+	// with a = w[0] a0 + w[1] b0 and b = w[2] a0 + w[3] b0 for the numbers a0, b0 they
+	// started from. Every step multiplies (a, b) by a matrix of determinant +-1, so the gcd
+	// never changes, even when a step guessed its quotients wrong and had to be fixed up
+
+	// bits [shift, shift + 64) of x
+	static uint64 gcdWindow(const BigInt *x, uint64 shift) {
+		sizeT index = shift >> 6, n = *x->size;
+		ubyte offset = shift & 63;
+		uint64 low = index < n ? x->_data[index] : 0, high = index + 1 < n ? x->_data[index + 1] : 0;
+		return offset ? (low >> offset) | (high << (64 - offset)) : low;
+	}
+
+	// flips negative results back to positive with their rows and puts the larger number first
+	static void gcdNormalize(BigInt *a, BigInt *b, BigInt *w) {
+		BigInt *values[2] = {a, b};
+		for (ubyte i = 0; i < 2; i++) {
+			if (!values[i]->sign)
+				continue;
+			values[i]->sign = 0;
+			if (w != nullptr) {
+				for (ubyte j = 2 * i; j < 2 * i + 2; j++)
+					if (*w[j].size)
+						w[j].sign ^= 1;
+			}
+		}
+		if (a->operator<(*b)) {
+			a->swap(*b);
+			if (w != nullptr) {
+				w[0].swap(w[2]);
+				w[1].swap(w[3]);
+			}
+		}
+	}
+
+	// (a, b) = (b, a mod b)
+	static void gcdDivisionStep(BigInt *a, BigInt *b, BigInt *w) {
+		BigInt q;
+		divTwoBigInts(a, 0, b, 0, &q, a);
+		a->swap(*b);
+		if (w != nullptr) {
+			addMulTwoBigInts(&q, q.sign ^ 1, &w[2], w[2].sign, &w[0]);
+			addMulTwoBigInts(&q, q.sign ^ 1, &w[3], w[3].sign, &w[1]);
+			w[0].swap(w[2]);
+			w[1].swap(w[3]);
+		}
+	}
+
+	// (x, y) = (m[0] x + m[1] y, m[2] x + m[3] y) for a matrix of words, t and u are scratch
+	static void gcdApplyWords(BigInt *x, BigInt *y, const int64 *m, BigInt *t, BigInt *u) {
+		multByUInt64(x, x->sign, m[0] < 0 ? 0 - (uint64) m[0] : m[0], m[0] < 0, t);
+		addMulUInt64(y, y->sign, m[1] < 0 ? 0 - (uint64) m[1] : m[1], m[1] < 0, t);
+		multByUInt64(x, x->sign, m[2] < 0 ? 0 - (uint64) m[2] : m[2], m[2] < 0, u);
+		addMulUInt64(y, y->sign, m[3] < 0 ? 0 - (uint64) m[3] : m[3], m[3] < 0, u);
+		x->swap(*t);
+		y->swap(*u);
+	}
+
+	// (x, y) = (v[0] x + v[1] y, v[2] x + v[3] y)
+	static void gcdApplyMatrix(BigInt *x, BigInt *y, const BigInt *v) {
+		BigInt t, u;
+		multTwoBigInts(&v[0], v[0].sign, x, x->sign, &t);
+		addMulTwoBigInts(&v[1], v[1].sign, y, y->sign, &t);
+		multTwoBigInts(&v[2], v[2].sign, x, x->sign, &u);
+		addMulTwoBigInts(&v[3], v[3].sign, y, y->sign, &u);
+		x->swap(t);
+		y->swap(u);
+	}
+
+	// Reduces a and b until b has at most s limbs. When enough limbs have to go, the leading
+	// 2h limbs of both numbers are reduced by h - 1 limbs recursively and the matrix of that
+	// reduction is applied to the whole numbers: the quotients of the leading halves are the
+	// quotients of the full numbers, so this removes about h limbs from a and b in O(M(n))
+	// and the whole reduction costs O(M(n) log n). Smaller reductions use Lehmer steps,
+	// each of which trades up to 62 bits of quotients for four word multiplications
+	static void gcdReduce(BigInt *a, BigInt *b, BigInt *w, sizeT s) {
+		BigInt t, u;
+		int64 m[4];
+		while (*b->size > s) {
+			sizeT n = *a->size, l = n - s;
+			if (w == nullptr && n == 1) {
+				a->_data[0] = Limbs::gcd1(a->_data[0], b->_data[0]);
+				b->_data.resize(0);
+				return;
+			}
+			// more than half of the limbs have to go: halve the numbers first,
+			// or divide when b is already that much shorter than a
+			if (2 * l > n && n / 2 >= Limbs::halfGcdThreshold) {
+				if (*b->size > n - n / 2)
+					gcdReduce(a, b, w, n - n / 2);
+				else
+					gcdDivisionStep(a, b, w);
+				continue;
+			}
+			// the leading part is at most about 2/3 of the numbers, so both recursive calls
+			// of a halving get n/2 limbs, the slack covers the limb each call keeps as margin
+			sizeT h = 3 * l <= n + 3 ? l : l / 2;
+			if (h >= Limbs::halfGcdThreshold && *b->size > n - h + 1) {
+				sizeT k = n - 2 * h;
+				BigInt aHigh, bHigh, v[4];
+				aHigh._data.resize(n - k);
+				Limbs::copy(aHigh._data.data(), a->_data.data() + k, n - k);
+				bHigh._data.resize(*b->size - k);
+				Limbs::copy(bHigh._data.data(), b->_data.data() + k, *b->size - k);
+				v[0] = BigInt((uint64) 1);
+				v[3] = BigInt((uint64) 1);
+				gcdReduce(&aHigh, &bHigh, v, h + 1);
+				gcdApplyMatrix(a, b, v);
+				if (w != nullptr) {
+					BigInt product[4];
+					for (ubyte i = 0; i < 4; i++) {
+						ubyte row = i & 2, column = i & 1;
+						multTwoBigInts(&v[row], v[row].sign, &w[column], w[column].sign, &product[i]);
+						addMulTwoBigInts(&v[row + 1], v[row + 1].sign, &w[column + 2], w[column + 2].sign, &product[i]);
+					}
+					for (ubyte i = 0; i < 4; i++)
+						w[i].swap(product[i]);
+				}
+				gcdNormalize(a, b, w);
+				// a wrong guess can only cost the progress of this round, not the result
+				if (*a->size >= n && *b->size > s)
+					gcdDivisionStep(a, b, w);
+				continue;
+			}
+			uint64 bits = 64 * (uint64) n - __builtin_clzll(a->_data[n - 1]);
+			uint64 shift = bits > 62 ? bits - 62 : 0;
+			Limbs::lehmerMatrix(gcdWindow(a, shift), gcdWindow(b, shift), m);
+			if (m[1] == 0) {
+				gcdDivisionStep(a, b, w);
+				continue;
+			}
+			gcdApplyWords(a, b, m, &t, &u);
+			if (w != nullptr) {
+				gcdApplyWords(&w[0], &w[2], m, &t, &u);
+				gcdApplyWords(&w[1], &w[3], m, &t, &u);
+			}
+			gcdNormalize(a, b, w);
+		}
+	}
+
+	// limbs of |a| without the zero ones on top, which resize() and operator[] can leave
+	static sizeT usedLimbs(const BigInt *a) {
+		sizeT n = *a->size;
+		while (n > 0 && a->_data[n - 1] == 0)
+			n--;
+		return n;
+	}
+
+	// number of bits in |a|, 0 for zero
+	static uint64 bitLength(const BigInt *a) {
+		sizeT n = usedLimbs(a);
+		return n == 0 ? 0 : 64ULL * n - __builtin_clzll(a->_data[n - 1]);
+	}
+
+	// log2 |a| from the leading 64 bits, a nonzero
+	static long double log2Abs(const BigInt *a) {
+		uint64 bits = bitLength(a);
+		sizeT n = *a->size;
+		uint64 lead = a->_data.back();
+		ubyte s = bits & 63;
+		if (n > 1 && s)
+			lead = (lead << (64 - s)) | (a->_data[n - 2] >> s);
+		return log2l((long double) lead) + (bits > 64 ? bits - 64 : 0);
+	}
+
+	static bool isSmallPrime(uint64 t_value) {
+		if (t_value < 2)
+			return false;
+		for (uint64 d = 2; d * d <= t_value; d++)
+			if (t_value % d == 0)
+				return false;
+		return true;
+	}
+
+	static uint64 powModWord(uint64 a, uint64 e, uint64 m) {
+		typedef unsigned __int128 wide;
+		uint64 result = 1 % m;
+		a %= m;
+		for (; e; e >>= 1) {
+			if (e & 1)
+				result = (wide) result * a % m;
+			a = (wide) a * a % m;
+		}
+		return result;
+	}
+
+	// res = |a| >> t_bits, res can't be a
+	static void shiftRightBits(const BigInt *a, uint64 t_bits, BigInt *res) {
+		sizeT n = *a->size, limbs = t_bits >> 6;
+		res->sign = 0;
+		if (limbs >= n) {
+			res->_data.resize(0);
+			return;
+		}
+		res->_data.resize(n - limbs);
+		if (t_bits & 63)
+			Limbs::shiftRight(res->_data.data(), a->_data.data() + limbs, n - limbs, t_bits & 63);
+		else
+			Limbs::copy(res->_data.data(), a->_data.data() + limbs, n - limbs);
+		res->removeLeadingZeros();
+	}
+
+	// a^k for k > 0 by squaring, left to right so the multiplier stays the small a
+	static BigInt powUInt(const BigInt &a, uint32 k) {
+		BigInt result(a);
+		for (int32 i = 30 - __builtin_clz(k); i >= 0; i--) {
+			result = result * result;
+			if ((k >> i) & 1)
+				result = result * a;
+		}
+		return result;
+	}
+
+	// Sets t_root to the p-th root of n > 1 for a prime p if it is exact. Cheap modular
+	// tests reject most p before any root is taken
+	static bool exactRoot(const BigInt &n, uint32 p, BigInt &t_root) {
+		// largest prime below 2^64
+		const uint64 check = 0xffffffffffffffc5ULL;
+		uint64 rootBits = (bitLength(&n) - 1) / p + 1;
+		if (rootBits <= 40) {
+			// a root this short is known within 1 from the leading bits
+			uint64 estimate = (uint64) (exp2l(log2Abs(&n) / p) + 0.5);
+			uint64 residue = n % check;
+			for (uint64 c = estimate > 1 ? estimate - 1 : 1; c <= estimate + 1; c++) {
+				if (powModWord(c, p, check) != residue)
+					continue;
+				t_root = BigInt(c);
+				if (powUInt(t_root, p) == n)
+					return true;
+			}
+			return false;
+		}
+		// an exact power is a p-th power residue modulo primes q = 1 mod p
+		for (uint64 q = 2 * p + 1, tested = 0; tested < 2; q += 2 * p) {
+			if (!isSmallPrime(q))
+				continue;
+			tested++;
+			uint64 residue = n % q;
+			if (residue && powModWord(residue, (q - 1) / p, q) != 1)
+				return false;
+		}
+		bool exact;
+		t_root = n.iroot(p, &exact);
+		return exact;
+	}
+
+	// Levels of a product tree, level 0 holds copies of the leaves and every level above
+	// the products of neighbouring pairs, with an odd one out moved up unchanged
+	static void productTree(const BigInt *t_values, sizeT t_count, Vector<Vector<BigInt>> &t_levels) {
+		sizeT depth = 1;
+		for (sizeT n = t_count; n > 1; n = (n + 1) / 2)
+			depth++;
+		t_levels.resize(depth);
+		t_levels[0].resize(t_count);
+		for (sizeT i = 0; i < t_count; i++)
+			t_levels[0][i] = t_values[i];
+		for (sizeT k = 1; k < depth; k++) {
+			const Vector<BigInt> &below = t_levels[k - 1];
+			Vector<BigInt> &level = t_levels[k];
+			sizeT n = *below.size;
+			level.resize((n + 1) / 2);
+			for (sizeT i = 0; i + 1 < n; i += 2)
+				level[i / 2] = below[i] * below[i + 1];
+			if (n & 1)
+				level[n / 2] = below[n - 1];
+		}
+	}
+
+	// Newton step towards the k-th root of n from x > 0, ((k - 1) x + n / x^(k - 1)) / k.
+	// Never goes below the root when rounding down, and moves down from any x above it
+	static BigInt rootStep(const BigInt &x, const BigInt &n, uint32 k) {
+		BigInt y = k == 2 ? n / x : n / powUInt(x, k - 1);
+		y.addmul(x, (uint64) (k - 1));
+		return y / (uint64) k;
+	}
+
 	void shiftLeft(BigInt *a, uint32 shiftSize, BigInt *res) {
 		uint32 newStart = (shiftSize >> 6);
 		uint32 newSize = *a->size + newStart + 1;
@@ -250,7 +1740,8 @@ private:
 		ubyte upper = shiftSize & 0b111111;
 		ubyte lower = 64 - upper;
 		for (int32 i = oldSize - 1, j = 0; i >= 0; i--, j++) {
-			res->_data[newStart + j + 1] |= (a->_data[j] >> lower);
+			if (upper)
+				res->_data[newStart + j + 1] |= (a->_data[j] >> lower);
 			res->_data[newStart + j] |= (a->_data[j] << upper);
 		}
 		res->removeLeadingZeros();
@@ -281,37 +1772,31 @@ public:
 	}
 	*/
 
+	// Zero gets no limbs, like BigInt()
 	BigInt(int64 value)
 		: BigInt() {
-		if (value < 0) {
+		if (value < 0)
 			sign = 1;
-			value = -value;
-		}
-		_data.push(value);
+		if (value != 0)
+			_data.push(value < 0 ? -(uint64) value : (uint64) value);
 	}
 
 	BigInt(uint64 value)
 		: BigInt() {
-		_data.push(value);
+		if (value != 0)
+			_data.push(value);
 	}
 
 	BigInt(String value) {
-		if (value[0] == U'-')
-			sign = 1;
-		int32 i = sign;
-		BigInt tmp;
-		tmp.resize(1);
-		int32 mod18tmp = *value.size % 18;
-		if (mod18tmp != 0) {
-			tmp[0] = value.substr(0, mod18tmp).toUInt();
-			addTwoBigInts(this, 0, &tmp, 0, this);
-			i += mod18tmp;
-		}
-		for (; i < *value.size; i += 18) {
-			multByUInt64(this, 0, 1000000000000000000ULL, 0, this);
-			tmp[0] = value.substr(i, 18).toUInt();
-			addTwoBigInts(this, 0, &tmp, 0, this);
-		}
+		sizeT start = (*value.size > 0 && value[0] == U'-') ? 1 : 0;
+		sizeT len = *value.size - start;
+		if (len == 0)
+			throw std::runtime_error("Cannot convert empty string to BigInt.");
+		Vector<Vector<uint64>> powers;
+		Limbs::decimalPowers(powers, (len + Limbs::decimalDigits - 1) / Limbs::decimalDigits);
+		_data.resize(Limbs::decimalLimbs(len));
+		_data.resize(Limbs::fromDecimal(_data.data(), value.data() + start, len, powers));
+		sign = start;
 		removeLeadingZeros();
 	}
 
@@ -328,7 +1813,24 @@ public:
 		return *this;
 	}
 
-	bool operator==(const BigInt &other) {
+	// takes over the limbs of other, which is left as zero
+	BigInt(BigInt &&other) noexcept
+		: _data(std::move(other._data)) {
+		sign = other.sign;
+		other.sign = 0;
+		size = _data.size;
+	}
+
+	BigInt &operator=(BigInt &&other) noexcept {
+		_data = std::move(other._data);
+		sign = other.sign;
+		if (this != &other)
+			other.sign = 0;
+		size = _data.size;
+		return *this;
+	}
+
+	bool operator==(const BigInt &other) const {
 		return _data == other._data;
 	}
 
@@ -368,68 +1870,133 @@ public:
 		return other.operator<(*this);
 	}
 
-	BigInt operator+(const BigInt &other) {
+	// Temporary operands have their storage reused for the result, so a chain like
+	// a * b + c * d only allocates for the two products
+
+	BigInt operator+(const BigInt &other) const & {
 		BigInt result;
 		addTwoBigInts(this, sign, &other, other.sign, &result);
 		return result;
 	}
 
+	BigInt operator+(const BigInt &other) && {
+		addTwoBigInts(this, sign, &other, other.sign, this);
+		return std::move(*this);
+	}
+
+	BigInt operator+(BigInt &&other) const & {
+		addTwoBigInts(&other, other.sign, this, sign, &other);
+		return std::move(other);
+	}
+
+	BigInt operator+(BigInt &&other) && {
+		addTwoBigInts(this, sign, &other, other.sign, this);
+		return std::move(*this);
+	}
+
 	BigInt &operator+=(const BigInt &other) {
 		addTwoBigInts(this, sign, &other, other.sign, this);
 		return *this;
 	}
 
-	BigInt operator-(const BigInt &other) {
+	BigInt operator-(const BigInt &other) const & {
 		BigInt result;
 		subTwoBigInts(this, sign, &other, other.sign, &result);
 		return result;
 	}
 
+	BigInt operator-(const BigInt &other) && {
+		subTwoBigInts(this, sign, &other, other.sign, this);
+		return std::move(*this);
+	}
+
+	BigInt operator-(BigInt &&other) const & {
+		subTwoBigInts(this, sign, &other, other.sign, &other);
+		return std::move(other);
+	}
+
+	BigInt operator-(BigInt &&other) && {
+		subTwoBigInts(this, sign, &other, other.sign, this);
+		return std::move(*this);
+	}
+
 	BigInt &operator-=(const BigInt &other) {
 		subTwoBigInts(this, sign, &other, other.sign, this);
 		return *this;
 	}
 
-	BigInt operator*(const BigInt &other) {
+	// this += a * b without a temporary for the product when one of the factors fits in a limb
+	BigInt &addmul(const BigInt &a, const BigInt &b) {
+		addMulTwoBigInts(&a, a.sign, &b, b.sign, this);
+		return *this;
+	}
+
+	BigInt &addmul(const BigInt &a, uint64 b) {
+		addMulUInt64(&a, a.sign, b, 0, this);
+		return *this;
+	}
+
+	// this -= a * b
+	BigInt &submul(const BigInt &a, const BigInt &b) {
+		addMulTwoBigInts(&a, a.sign, &b, b.sign ^ 1, this);
+		return *this;
+	}
+
+	BigInt &submul(const BigInt &a, uint64 b) {
+		addMulUInt64(&a, a.sign, b, 1, this);
+		return *this;
+	}
+
+	BigInt operator*(const BigInt &other) const {
 		BigInt result;
 		multTwoBigInts(this, sign, &other, other.sign, &result);
 		return result;
 	}
 
-	BigInt operator*=(const BigInt &other) {
+	BigInt &operator*=(const BigInt &other) {
 		multTwoBigInts(this, sign, &other, other.sign, this);
 		return *this;
 	}
 
-	BigInt operator*(uint64 a) {
+	BigInt operator*(uint64 a) const & {
 		BigInt result;
 		multByUInt64(this, sign, a, 0, &result);
 		return result;
 	}
 
-	BigInt operator*(int64 a) {
+	BigInt operator*(uint64 a) && {
+		multByUInt64(this, sign, a, 0, this);
+		return std::move(*this);
+	}
+
+	BigInt operator*(int64 a) const & {
 		BigInt result;
-		multByUInt64(this, sign, a, a < 0, &result);
+		multByUInt64(this, sign, a < 0 ? 0 - (uint64) a : a, a < 0, &result);
 		return result;
 	}
 
-	BigInt operator*=(uint64 a) {
+	BigInt operator*(int64 a) && {
+		multByUInt64(this, sign, a < 0 ? 0 - (uint64) a : a, a < 0, this);
+		return std::move(*this);
+	}
+
+	BigInt &operator*=(uint64 a) {
 		multByUInt64(this, sign, a, 0, this);
 		return *this;
 	}
 
-	BigInt operator*=(int64 a) {
-		multByUInt64(this, sign, a, a < 0, this);
+	BigInt &operator*=(int64 a) {
+		multByUInt64(this, sign, a < 0 ? 0 - (uint64) a : a, a < 0, this);
 		return *this;
 	}
 
-	BigInt operator/(uint64 a) {
+	BigInt operator/(uint64 a) const {
 		BigInt result;
 		divByUInt64(this, sign, a, 0, &result);
 		return result;
 	}
 
-	BigInt operator/(int64 a) {
+	BigInt operator/(int64 a) const {
 		BigInt result;
 		divByUInt64(this, sign, a, a < 0, &result);
 		return result;
@@ -445,6 +2012,120 @@ public:
 		return *this;
 	}
 
+	BigInt operator/(const BigInt &other) const {
+		BigInt result;
+		divTwoBigInts(this, sign, &other, other.sign, &result, nullptr);
+		return result;
+	}
+
+	BigInt &operator/=(const BigInt &other) {
+		divTwoBigInts(this, sign, &other, other.sign, this, nullptr);
+		return *this;
+	}
+
+	BigInt operator%(const BigInt &other) const {
+		BigInt result;
+		divTwoBigInts(this, sign, &other, other.sign, nullptr, &result);
+		return result;
+	}
+
+	BigInt &operator%=(const BigInt &other) {
+		divTwoBigInts(this, sign, &other, other.sign, nullptr, this);
+		return *this;
+	}
+
+	Pair<BigInt, BigInt> divrem(const BigInt &other) const {
+		BigInt quot, rem;
+		divTwoBigInts(this, sign, &other, other.sign, &quot, &rem);
+		return {quot, rem};
+	}
+
+	// this^exponent mod modulus for a positive modulus, the result is in [0, modulus).
+	// Odd moduli use Montgomery multiplication, even ones Barrett reduction,
+	// MontgomeryContext can be kept around to reuse the setup for one modulus
+	BigInt powmod(const BigInt &exponent, const BigInt &modulus);
+
+	// Multiplications with operands of tens of thousands of limbs and more run their
+	// transforms on the workers of t_pool from now on, nullptr goes back to one thread.
+	// Set it before the multiplications start, the pool has to outlive them.
+	// The speedup is unverified: it has only been measured on a single core, where the pool
+	// costs up to 20% on 2^20 limb products. bench/parallel_mul.cpp measures it
+	static void setThreadPool(ThreadPool *t_pool) {
+		Limbs::multiplyPool() = t_pool;
+	}
+
+	// Greatest common divisor of the absolute values, Lehmer steps for mid-sized numbers
+	// and a half-gcd recursion for large ones
+	BigInt gcd(const BigInt &other) const;
+
+	BigInt lcm(const BigInt &other) const;
+
+	// returns g = gcd(this, other) and sets x and y so that this * x + other * y = g
+	BigInt gcdext(const BigInt &other, BigInt &x, BigInt &y) const;
+
+	// x with this * x = 1 modulo modulus, 0 <= x < modulus
+	BigInt modinv(const BigInt &modulus) const;
+
+	// Binary form: one word holding (number of limbs << 1) | sign, then the limbs
+	// least significant first. Records are whole words, so they stay aligned back to back
+	sizeT serializedSize() const {
+		return *size + 1;
+	}
+
+	// writes serializedSize() words to t_out, returns the end of the record
+	uint64 *serialize(uint64 *t_out) const;
+
+	// reads the record starting at t_in, which may not reach past t_end,
+	// returns the end of the record
+	const uint64 *deserialize(const uint64 *t_in, const uint64 *t_end);
+
+	// A read-only BigInt using the limbs of the record at t_in in place, e.g. from a mapped file.
+	// The memory has to outlive the view. t_next receives the end of the record
+	static BigIntView view(const uint64 *t_in, const uint64 *t_end, const uint64 **t_next = nullptr);
+
+	// File of t_count records after a magic word and the count, see BigIntMap for reading it in place
+	static void writeFile(const char *t_path, const BigInt *t_values, sizeT t_count);
+
+	static Vector<BigInt> readFile(const char *t_path);
+
+	// Integer k-th root rounded toward zero, via Newton iterations that start from a
+	// floating estimate of the top bits and double the precision at every step,
+	// so the cost is a small multiple of one multiplication of the full size.
+	// Even roots of negative numbers throw. t_exact is set when the root is exact
+	BigInt iroot(uint32 k, bool *t_exact = nullptr) const;
+
+	BigInt isqrt(bool *t_exact = nullptr) const {
+		return iroot(2, t_exact);
+	}
+
+	// true if this = base^exponent for some exponent > 1, returns the largest such exponent
+	// in t_exponent. 0 and 1 count as squares, -1 as a cube
+	bool isPerfectPower(BigInt *t_base = nullptr, uint32 *t_exponent = nullptr) const;
+
+	// Product of t_count values multiplied pairwise up a balanced tree, so the large
+	// multiplications get operands of equal size. The empty product is 1
+	static BigInt product(const BigInt *t_values, sizeT t_count);
+
+	// t_out[i] = t_value mod t_moduli[i] in [0, t_moduli[i]) for positive moduli, reducing
+	// down a product tree of the moduli so each level costs about one division of the full size
+	static void remainders(const BigInt &t_value, const BigInt *t_moduli, sizeT t_count, BigInt *t_out);
+
+	static void remainders(const BigInt &t_value, const uint64 *t_moduli, sizeT t_count, uint64 *t_out);
+
+	// The x in [0, product of the moduli) with x = t_residues[i] mod t_moduli[i], building the
+	// sum of residue * (M / m_i) * ((M / m_i)^-1 mod m_i) up the product tree. Throws if the
+	// moduli aren't pairwise coprime
+	static BigInt crt(const BigInt *t_residues, const BigInt *t_moduli, sizeT t_count);
+
+	static BigInt crt(const uint64 *t_residues, const uint64 *t_moduli, sizeT t_count);
+
+	// exchanges the values without copying limbs
+	void swap(BigInt &other) {
+		BigInt tmp(std::move(other));
+		other = std::move(*this);
+		*this = std::move(tmp);
+	}
+
 	BigInt operator<<(uint32 a) {
 		BigInt result;
 		shiftLeft(this, a, &result);
@@ -456,21 +2137,21 @@ public:
 		return *this;
 	}
 
-	uint64 operator%(uint64 a) {
+	uint64 operator%(uint64 a) const {
 		return divByUInt64(this, sign, a, 0, nullptr);
 	}
 
-	int64 operator%(int64 a) {
+	int64 operator%(int64 a) const {
 		return divByUInt64(this, sign, a, a < 0, nullptr);
 	}
 
-	Pair<BigInt, uint64> divrem(uint64 a) {
+	Pair<BigInt, uint64> divrem(uint64 a) const {
 		BigInt result;
 		uint64 res = divByUInt64(this, sign, a, 0, &result);
 		return {result, res};
 	}
 
-	Pair<BigInt, int64> divrem(int64 a) {
+	Pair<BigInt, int64> divrem(int64 a) const {
 		BigInt result;
 		int64 res = divByUInt64(this, sign, a, a < 0, &result);
 		return {result, res};
@@ -480,6 +2161,7 @@ public:
 		uint64 res = divByUInt64(this, sign, a, 0, nullptr);
 		_data.resize(1);
 		_data[0] = res;
+		removeLeadingZeros();
 		return *this;
 	}
 
@@ -491,10 +2173,16 @@ public:
 			res = -res;
 		}
 		_data[0] = res;
+		removeLeadingZeros();
 		return *this;
 	}
 
-	uint64 &operator[](int32 i) const {
+	uint64 &operator[](int32 i) {
+		return _data[i];
+	}
+
+	// const BigInts, views included, can only be read
+	uint64 operator[](int32 i) const {
 		return _data[i];
 	}
 
@@ -502,36 +2190,751 @@ public:
 		return _data.at(i);
 	}
 
+	// Raw access to the limbs, least significant first
+	uint64 *data() {
+		return _data.data();
+	}
+
+	const uint64 *data() const {
+		return _data.data();
+	}
+
 	void resize(uint32 sz) {
 		_data.resize(sz);
 	}
 
-	String getValue() {
-		String result;
-		BigInt tmpn;
-		uint64 dmod = divByUInt64(this, 0, 1000000000000000000ULL, 0, &tmpn);
-		uint64 recip = getReciprocal64(10ULL);
-		while (*tmpn.size) {
-			for (int32 i = 0; i < 18; i++) {
-				uint64 newcur = div64UsingMult(dmod, recip);
-				uint64 mod = getModFromDiv(dmod, 10ULL, newcur);
-				result += String(1, char('0' + mod));
-				dmod = newcur;
+	String getValue() const {
+		sizeT n = usedLimbs(this);
+		if (n == 0)
+			return String((sizeT) 1, '0');
+		// 18-digit chunks from the bit length, at most one chunk more than needed
+		uint64 bits = bitLength(this);
+		sizeT chunks = (sizeT) (bits * 0.30103 / Limbs::decimalDigits) + 1;
+		Vector<Vector<uint64>> powers;
+		Limbs::decimalPowers(powers, chunks);
+		String result((sizeT) (sign + chunks * Limbs::decimalDigits));
+		char32_t *out = result.data() + sign;
+		Limbs::toDecimal(_data.data(), n, out, chunks, powers);
+		sizeT zeros = 0;
+		while (out[zeros] == U'0')
+			zeros++;
+		sizeT digits = chunks * Limbs::decimalDigits - zeros;
+		for (sizeT i = 0; i < digits; i++)
+			out[i] = out[i + zeros];
+		if (sign)
+			result[0] = U'-';
+		result.resize(sign + digits);
+		return result;
+	}
+};
+
+// Modular arithmetic contexts for a fixed modulus. The reduction constants and all the
+// workspace are set up once in the constructor, so mul and pow on limb arrays don't
+// allocate as long as the modulus stays below the Toom-3 threshold (12288 bits).
+
+namespace Limbs {
+	// Exponent bits handled by one table lookup in sliding-window exponentiation
+	inline ubyte windowSize(uint64 bits) {
+		if (bits <= 24)
+			return 1;
+		if (bits <= 80)
+			return 3;
+		if (bits <= 240)
+			return 4;
+		if (bits <= 672)
+			return 5;
+		return 6;
+	}
+
+	// Left-to-right sliding-window exponentiation. Context provides mul(r, a, b) and
+	// size(), base and r are in the context's representation, table holds 32 * size() limbs
+	template<typename Context>
+	void powWindow(Context &ctx, uint64 *r, const uint64 *base, const uint64 *one, const uint64 *e, sizeT en, uint64 *table) {
+		sizeT n = ctx.size();
+		while (en > 0 && e[en - 1] == 0)
+			en--;
+		if (en == 0) {
+			copy(r, one, n);
+			return;
+		}
+		uint64 bits = 64ULL * en - __builtin_clzll(e[en - 1]);
+		ubyte w = windowSize(bits);
+
+		// table[i] = base^(2i + 1), r holds base^2 while the table is filled
+		copy(table, base, n);
+		ctx.mul(r, base, base);
+		for (sizeT i = 1; i < ((sizeT) 1 << (w - 1)); i++)
+			ctx.mul(table + i * n, table + (i - 1) * n, r);
+
+		bool started = false;
+		for (int64 i = bits - 1; i >= 0;) {
+			if (((e[i >> 6] >> (i & 63)) & 1) == 0) {
+				ctx.mul(r, r, r);
+				i--;
+				continue;
+			}
+			// the longest window of at most w bits starting at bit i and ending with a one
+			int64 j = Algorithm::max(i - w + 1, (int64) 0);
+			while (((e[j >> 6] >> (j & 63)) & 1) == 0)
+				j++;
+			uint64 value = 0;
+			for (int64 k = i; k >= j; k--)
+				value = (value << 1) | ((e[k >> 6] >> (k & 63)) & 1);
+			if (started) {
+				for (int64 k = i; k >= j; k--)
+					ctx.mul(r, r, r);
+				ctx.mul(r, r, table + (value >> 1) * n);
+			} else {
+				copy(r, table + (value >> 1) * n, n);
+				started = true;
 			}
-			dmod = divByUInt64(&tmpn, 0, 1000000000000000000ULL, 0, &tmpn);
+			i = j - 1;
 		}
-		while (dmod) {
-			uint64 newcur = div64UsingMult(dmod, recip);
-			uint64 mod = getModFromDiv(dmod, 10ULL, newcur);
-			result += String(1, char('0' + mod));
-			dmod = newcur;
+	}
+}
+
+// BigInt front end shared by the contexts, reduces the base into [0, m) and runs the limb-level pow
+template<typename Context>
+BigInt contextPow(Context &ctx, BigInt &modulus, uint64 *baseBuffer, const BigInt &base, const BigInt &exponent) {
+	if (exponent.sign)
+		throw std::logic_error("Can't raise to negative power modulo a number.");
+	sizeT n = ctx.size();
+	BigInt reduced = base;
+	reduced %= modulus;
+	if (reduced.sign) {
+		reduced.sign = 0;
+		reduced = modulus - reduced;
+	}
+	Limbs::zero(baseBuffer, n);
+	Limbs::copy(baseBuffer, reduced.data(), *reduced.size);
+	BigInt result;
+	result.resize(n);
+	ctx.pow(result.data(), baseBuffer, exponent.data(), *exponent.size);
+	while (*result.size > 0 && result[*result.size - 1] == 0)
+		result.resize(*result.size - 1);
+	return result;
+}
+
+// Montgomery multiplication modulo an odd m of n limbs, with R = 2^(64n).
+// Values live in Montgomery form a*R mod m, a product costs one multiplication
+// plus an n^2 word-by-word reduction and never divides
+class MontgomeryContext {
+	sizeT _size;
+	uint64 _inverse;
+	BigInt _modulusValue;
+	Vector<uint64> _modulus, _r2, _one;
+	Vector<uint64> _product, _scratch, _table, _base;
+
+	// r = t * R^-1 mod m for t of 2n limbs below m * R, t is destroyed
+	void reduce(uint64 *r, uint64 *t) {
+		const uint64 *m = _modulus.data();
+		uint64 carry = 0;
+		for (sizeT i = 0; i < _size; i++) {
+			uint64 c = Limbs::addMul1(t + i, m, _size, t[i] * _inverse);
+			uint64 cur = t[i + _size] + c;
+			uint64 out = cur < c;
+			t[i + _size] = cur + carry;
+			carry = out + (t[i + _size] < carry);
 		}
-		if (*result.size == 0)
-			result += String(1, '0');
-		if (sign)
-			result += String(1, '-');
-		Algorithm::reverse(result, *result.size);
-		return result;
+		if (carry || Limbs::cmp(t + _size, m, _size) >= 0)
+			Limbs::subN(r, t + _size, m, _size);
+		else
+			Limbs::copy(r, t + _size, _size);
+	}
+
+public:
+	MontgomeryContext(const BigInt &modulus)
+		: _size(*modulus.size),
+		  _modulusValue(modulus) {
+		if (_size == 0 || modulus.sign || (modulus[0] & 1) == 0)
+			throw std::logic_error("Montgomery reduction needs an odd positive modulus.");
+		_modulus.resize(_size);
+		Limbs::copy(_modulus.data(), modulus.data(), _size);
+		// Newton iteration for m^-1 mod 2^64, each step doubles the correct bits
+		uint64 inv = _modulus[0];
+		for (ubyte i = 0; i < 5; i++)
+			inv *= 2 - _modulus[0] * inv;
+		_inverse = -inv;
+
+		_product.resize(2 * _size + 1);
+		_scratch.resize(Limbs::mulScratchSize(_size));
+		_table.resize(32 * _size);
+		_base.resize(_size);
+		_one.resize(_size);
+		_r2.resize(_size);
+		// R^2 mod m from one division, then R mod m = R^2 * R^-1
+		Vector<uint64> power(2 * _size + 1), quotient(_size + 2);
+		power[2 * _size] = 1;
+		Limbs::divRem(quotient.data(), _r2.data(), power.data(), 2 * _size + 1, _modulus.data(), _size);
+		Limbs::copy(_product.data(), _r2.data(), _size);
+		Limbs::zero(_product.data() + _size, _size);
+		reduce(_one.data(), _product.data());
+	}
+
+	sizeT size() const {
+		return _size;
+	}
+
+	// r = a * b * R^-1 mod m, r may be the same array as a or b
+	void mul(uint64 *r, const uint64 *a, const uint64 *b) {
+		Limbs::mulBalanced(_product.data(), a, b, _size, _scratch.data());
+		reduce(r, _product.data());
+	}
+
+	// a must be below m
+	void toMontgomery(uint64 *r, const uint64 *a) {
+		mul(r, a, _r2.data());
+	}
+
+	void fromMontgomery(uint64 *r, const uint64 *a) {
+		Limbs::copy(_product.data(), a, _size);
+		Limbs::zero(_product.data() + _size, _size);
+		reduce(r, _product.data());
+	}
+
+	// r = base^e mod m for base below m, both in the usual form
+	void pow(uint64 *r, const uint64 *base, const uint64 *e, sizeT en) {
+		toMontgomery(_base.data(), base);
+		Limbs::powWindow(*this, r, _base.data(), _one.data(), e, en, _table.data());
+		fromMontgomery(r, r);
+	}
+
+	BigInt pow(const BigInt &base, const BigInt &exponent) {
+		return contextPow(*this, _modulusValue, _base.data(), base, exponent);
+	}
+};
+
+// Barrett reduction modulo any m of n limbs, using mu = floor(B^2n / m).
+// Slower than Montgomery, used for even moduli where Montgomery form doesn't exist
+class BarrettContext {
+	sizeT _size;
+	BigInt _modulusValue;
+	Vector<uint64> _modulus, _mu;
+	Vector<uint64> _product, _estimate, _scratch, _table, _base, _one;
+
+	// r = t mod m for t of 2n limbs below m^2, t is destroyed
+	void reduce(uint64 *r, uint64 *t) {
+		sizeT n = _size;
+		uint64 *q = _estimate.data(), *qm = q + 2 * n + 2;
+		// q = floor(floor(t / B^(n-1)) * mu / B^(n+1)) is at most 2 below the quotient
+		t[2 * n] = 0;
+		Limbs::mulBalanced(q, t + n - 1, _mu.data(), n + 1, _scratch.data());
+		Limbs::mulBalanced(qm, q + n + 1, _modulus.data(), n + 1, _scratch.data());
+		Limbs::subN(t, t, qm, n + 1);
+		while (Limbs::cmp(t, _modulus.data(), n + 1) >= 0)
+			Limbs::subN(t, t, _modulus.data(), n + 1);
+		Limbs::copy(r, t, n);
+	}
+
+public:
+	BarrettContext(const BigInt &modulus)
+		: _size(*modulus.size),
+		  _modulusValue(modulus) {
+		if (_size == 0 || modulus.sign)
+			throw std::logic_error("Barrett reduction needs a positive modulus.");
+		// the modulus is kept with one zero limb on top for the n + 1 limb steps
+		_modulus.resize(_size + 1);
+		Limbs::copy(_modulus.data(), modulus.data(), _size);
+		_modulus[_size] = 0;
+		_mu.resize(_size + 2);
+		Vector<uint64> power(2 * _size + 1), remainder(_size);
+		power[2 * _size] = 1;
+		Limbs::divRem(_mu.data(), remainder.data(), power.data(), 2 * _size + 1, _modulus.data(), _size);
+		// mu = B^(n+1) only for m = B^(n-1), one less just costs an extra final subtraction
+		if (_mu[_size + 1] != 0) {
+			_mu[_size + 1] = 0;
+			Limbs::sub1(_mu.data(), _mu.data(), _size + 1, 1);
+		}
+
+		_product.resize(2 * _size + 1);
+		_estimate.resize(4 * _size + 4);
+		_scratch.resize(Limbs::mulScratchSize(_size + 1));
+		_table.resize(32 * _size);
+		_base.resize(_size);
+		_one.resize(_size);
+		// 1 mod m, which is 0 when m = 1
+		_one[0] = _size > 1 || _modulus[0] > 1;
+	}
+
+	sizeT size() const {
+		return _size;
+	}
+
+	// r = a * b mod m for a, b below m, r may be the same array as a or b
+	void mul(uint64 *r, const uint64 *a, const uint64 *b) {
+		Limbs::mulBalanced(_product.data(), a, b, _size, _scratch.data());
+		reduce(r, _product.data());
+	}
+
+	// r = base^e mod m for base below m
+	void pow(uint64 *r, const uint64 *base, const uint64 *e, sizeT en) {
+		Limbs::powWindow(*this, r, base, _one.data(), e, en, _table.data());
+	}
+
+	BigInt pow(const BigInt &base, const BigInt &exponent) {
+		return contextPow(*this, _modulusValue, _base.data(), base, exponent);
+	}
+};
+
+inline BigInt BigInt::powmod(const BigInt &exponent, const BigInt &modulus) {
+	if (*modulus.size == 0 || modulus.sign)
+		throw std::logic_error("Modulus must be positive.");
+	if (modulus[0] & 1) {
+		MontgomeryContext ctx(modulus);
+		return ctx.pow(*this, exponent);
+	}
+	BarrettContext ctx(modulus);
+	return ctx.pow(*this, exponent);
+}
+
+inline BigInt BigInt::gcd(const BigInt &other) const {
+	BigInt a(*this), b(other);
+	a.removeLeadingZeros();
+	b.removeLeadingZeros();
+	a.sign = b.sign = 0;
+	gcdNormalize(&a, &b, nullptr);
+	gcdReduce(&a, &b, nullptr, 0);
+	return a;
+}
+
+inline BigInt BigInt::lcm(const BigInt &other) const {
+	if (bitLength(this) == 0 || bitLength(&other) == 0)
+		return BigInt();
+	BigInt result = *this / gcd(other) * other;
+	result.sign = 0;
+	return result;
+}
+
+inline BigInt BigInt::gcdext(const BigInt &other, BigInt &x, BigInt &y) const {
+	BigInt a(*this), b(other), w[4];
+	a.removeLeadingZeros();
+	b.removeLeadingZeros();
+	a.sign = b.sign = 0;
+	w[0] = BigInt((uint64) 1);
+	w[3] = BigInt((uint64) 1);
+	gcdNormalize(&a, &b, w);
+	gcdReduce(&a, &b, w, 0);
+	// the cofactors were found for the absolute values
+	x = std::move(w[0]);
+	y = std::move(w[1]);
+	if (sign && *x.size)
+		x.sign ^= 1;
+	if (other.sign && *y.size)
+		y.sign ^= 1;
+	return a;
+}
+
+inline BigInt BigInt::modinv(const BigInt &modulus) const {
+	if (modulus.sign || bitLength(&modulus) == 0)
+		throw std::logic_error("Modulus must be positive.");
+	BigInt x, y;
+	BigInt g = gcdext(modulus, x, y);
+	if (*g.size != 1 || g[0] != 1)
+		throw std::runtime_error("BigInt is not invertible modulo the given modulus.");
+	x %= modulus;
+	if (x.sign)
+		x += modulus;
+	return x;
+}
+
+inline BigInt BigInt::iroot(uint32 k, bool *t_exact) const {
+	if (k == 0)
+		throw std::logic_error("Root degree must be positive.");
+	if (sign && k % 2 == 0)
+		throw std::runtime_error("Even root of a negative BigInt.");
+	// zero limbs left on top by resize() would throw off the start estimate
+	BigInt n(*this), top;
+	n.removeLeadingZeros();
+	uint64 bits = bitLength(&n);
+	if (k == 1 || bits <= 1) {
+		if (t_exact)
+			*t_exact = true;
+		return n;
+	}
+	n.sign = 0;
+	// the precision of the root doubles from stage to stage, with 16 guard bits
+	uint64 rootBits = (bits - 1) / k + 1;
+	uint64 precision = rootBits;
+	Vector<uint64> stages;
+	while (precision > 48) {
+		stages.push(precision);
+		precision = precision / 2 + 16;
+	}
+	// the estimate is rounded up, Newton steps from above stay above the root
+	uint64 shift = rootBits - precision;
+	shiftRightBits(&n, shift * k, &top);
+	BigInt x((uint64) exp2l(log2Abs(&top) / k) + 2);
+	for (sizeT i = *stages.size; i-- > 0;) {
+		uint64 next = rootBits - stages[i];
+		x += BigInt((uint64) 1);
+		x <<= shift - next;
+		shift = next;
+		if (shift > 0) {
+			shiftRightBits(&n, shift * k, &top);
+			x = rootStep(x, top, k);
+		} else {
+			x = rootStep(x, n, k);
+		}
+	}
+	// at most a few above the root here
+	BigInt power = powUInt(x, k);
+	while (n < power) {
+		x -= BigInt((uint64) 1);
+		power = powUInt(x, k);
+	}
+	if (t_exact)
+		*t_exact = power == n;
+	x.sign = sign;
+	return x;
+}
+
+inline bool BigInt::isPerfectPower(BigInt *t_base, uint32 *t_exponent) const {
+	BigInt base(*this), root;
+	base.removeLeadingZeros();
+	if (bitLength(&base) <= 1) {
+		if (t_base)
+			*t_base = base;
+		if (t_exponent)
+			*t_exponent = sign ? 3 : 2;
+		return true;
+	}
+	// a p-th power has a multiple of p trailing zero bits
+	uint64 zeros = 0;
+	while (_data[zeros >> 6] == 0)
+		zeros += 64;
+	zeros += __builtin_ctzll(_data[zeros >> 6]);
+	base.sign = 0;
+	uint32 exponent = 1;
+	// the smallest prime exponent is taken out first, then the root is tested again.
+	// Negative numbers only have odd exponents, which keep the sign on the base
+	for (uint32 p = sign ? 3 : 2; p < bitLength(&base); p++) {
+		if (!isSmallPrime(p) || (zeros / exponent) % p != 0)
+			continue;
+		if (exactRoot(base, p, root)) {
+			base = std::move(root);
+			exponent *= p;
+			p--;
+		}
+	}
+	base.sign = sign;
+	if (t_base)
+		*t_base = base;
+	if (t_exponent)
+		*t_exponent = exponent;
+	return exponent > 1;
+}
+
+inline BigInt BigInt::product(const BigInt *t_values, sizeT t_count) {
+	if (t_count == 0)
+		return BigInt((uint64) 1);
+	Vector<BigInt> level((t_count + 1) / 2);
+	for (sizeT i = 0; i + 1 < t_count; i += 2)
+		level[i / 2] = t_values[i] * t_values[i + 1];
+	if (t_count & 1)
+		level[t_count / 2] = t_values[t_count - 1];
+	// pairs are multiplied in place, the product of i and i + 1 goes to i / 2
+	for (sizeT n = (t_count + 1) / 2; n > 1; n = (n + 1) / 2) {
+		for (sizeT i = 0; i + 1 < n; i += 2)
+			level[i / 2] = level[i] * level[i + 1];
+		if (n & 1)
+			level[n / 2] = std::move(level[n - 1]);
+	}
+	return std::move(level[0]);
+}
+
+inline void BigInt::remainders(const BigInt &t_value, const BigInt *t_moduli, sizeT t_count, BigInt *t_out) {
+	if (t_count == 0)
+		return;
+	for (sizeT i = 0; i < t_count; i++)
+		if (*t_moduli[i].size == 0 || t_moduli[i].sign)
+			throw std::logic_error("Modulus must be positive.");
+	Vector<Vector<BigInt>> tree;
+	productTree(t_moduli, t_count, tree);
+	sizeT depth = *tree.size;
+	Vector<BigInt> rem[2];
+	rem[0].resize(1);
+	rem[0][0] = t_value % tree[depth - 1][0];
+	if (rem[0][0].sign)
+		rem[0][0] += tree[depth - 1][0];
+	for (sizeT k = depth - 1; k > 0; k--) {
+		const Vector<BigInt> &above = rem[(depth - 1 - k) & 1];
+		Vector<BigInt> &below = rem[(depth - k) & 1];
+		const Vector<BigInt> &nodes = tree[k - 1];
+		sizeT n = *nodes.size;
+		below.resize(n);
+		for (sizeT i = 0; i < n; i++) {
+			// an odd one out is its own parent and its remainder is already reduced
+			if (above[i / 2] < nodes[i])
+				below[i] = above[i / 2];
+			else
+				below[i] = above[i / 2] % nodes[i];
+		}
+	}
+	const Vector<BigInt> &leaves = rem[(depth - 1) & 1];
+	for (sizeT i = 0; i < t_count; i++)
+		t_out[i] = leaves[i];
+}
+
+inline void BigInt::remainders(const BigInt &t_value, const uint64 *t_moduli, sizeT t_count, uint64 *t_out) {
+	Vector<BigInt> moduli(t_count), out(t_count);
+	for (sizeT i = 0; i < t_count; i++) {
+		if (t_moduli[i] == 0)
+			throw std::logic_error("Modulus must be positive.");
+		moduli[i] = BigInt(t_moduli[i]);
+	}
+	remainders(t_value, moduli.data(), t_count, out.data());
+	for (sizeT i = 0; i < t_count; i++)
+		t_out[i] = *out[i].size ? out[i][0] : 0;
+}
+
+inline BigInt BigInt::crt(const BigInt *t_residues, const BigInt *t_moduli, sizeT t_count) {
+	if (t_count == 0)
+		return BigInt();
+	for (sizeT i = 0; i < t_count; i++)
+		if (*t_moduli[i].size == 0 || t_moduli[i].sign)
+			throw std::logic_error("Modulus must be positive.");
+	Vector<Vector<BigInt>> tree;
+	productTree(t_moduli, t_count, tree);
+	sizeT depth = *tree.size;
+	const BigInt &total = tree[depth - 1][0];
+	// (M / m_i) mod m_i is (M mod m_i^2) / m_i
+	Vector<BigInt> squares(t_count), cofactors(t_count), residues(t_count), level(t_count);
+	for (sizeT i = 0; i < t_count; i++)
+		squares[i] = t_moduli[i] * t_moduli[i];
+	remainders(total, squares.data(), t_count, cofactors.data());
+	for (sizeT i = 0; i < t_count; i++) {
+		residues[i] = t_residues[i] % t_moduli[i];
+		if (residues[i].sign)
+			residues[i] += t_moduli[i];
+		BigInt inverse = (cofactors[i] / t_moduli[i]).modinv(t_moduli[i]);
+		level[i] = residues[i] * inverse % t_moduli[i];
+	}
+	// the value of a node is the sum of its leaves' terms divided by the moduli outside it
+	for (sizeT k = 1; k < depth; k++) {
+		const Vector<BigInt> &nodes = tree[k - 1];
+		sizeT n = *nodes.size;
+		for (sizeT i = 0; i + 1 < n; i += 2) {
+			BigInt sum = level[i] * nodes[i + 1];
+			sum.addmul(level[i + 1], nodes[i]);
+			level[i / 2] = std::move(sum);
+		}
+		if (n & 1)
+			level[n / 2] = std::move(level[n - 1]);
+	}
+	return level[0] % total;
+}
+
+inline BigInt BigInt::crt(const uint64 *t_residues, const uint64 *t_moduli, sizeT t_count) {
+	Vector<BigInt> residues(t_count), moduli(t_count);
+	for (sizeT i = 0; i < t_count; i++) {
+		if (t_moduli[i] == 0)
+			throw std::logic_error("Modulus must be positive.");
+		residues[i] = BigInt(t_residues[i]);
+		residues[i].removeLeadingZeros();
+		moduli[i] = BigInt(t_moduli[i]);
+	}
+	return crt(residues.data(), moduli.data(), t_count);
+}
+
+namespace Limbs {
+	// "BIGINT1" followed by a zero byte, read as a little-endian word
+	const uint64 fileMagic = 0x0031544e49474942ULL;
+
+	// the largest count of limbs or records that fits in sizeT
+	const uint64 maxCount = (sizeT) -1;
+
+	// number of limbs in a record header, throws if the record doesn't fit before t_end
+	inline sizeT recordLimbs(const uint64 *t_in, const uint64 *t_end) {
+		if (t_in >= t_end)
+			throw std::runtime_error("BigInt record is truncated.");
+		uint64 n = *t_in >> 1;
+		if (n > (uint64) (t_end - t_in - 1))
+			throw std::runtime_error("BigInt record is truncated.");
+		if (n > maxCount)
+			throw std::length_error("BigInt record is too long.");
+		if ((n == 0 && (*t_in & 1)) || (n > 0 && t_in[n] == 0))
+			throw std::runtime_error("BigInt record is not normalized.");
+		return n;
+	}
+}
+
+inline uint64 *BigInt::serialize(uint64 *t_out) const {
+	sizeT n = *size;
+	*t_out = (uint64) n << 1 | sign;
+	Limbs::copy(t_out + 1, _data.data(), n);
+	return t_out + 1 + n;
+}
+
+inline const uint64 *BigInt::deserialize(const uint64 *t_in, const uint64 *t_end) {
+	sizeT n = Limbs::recordLimbs(t_in, t_end);
+	_data.resize(n);
+	Limbs::copy(_data.data(), t_in + 1, n);
+	sign = *t_in & 1;
+	return t_in + 1 + n;
+}
+
+// Read-only BigInt over limbs it doesn't own, such as a record in a mapped file. It only
+// hands out a const BigInt, so a BigInt made from it copies the limbs and can't write back.
+// References to that BigInt live only as long as the view itself
+
+class BigIntView {
+	friend class BigInt;
+
+	BigInt _value;
+
+	BigIntView() {}
+
+public:
+	const BigInt &value() const {
+		return _value;
+	}
+
+	operator const BigInt &() const {
+		return _value;
+	}
+};
+
+inline BigIntView BigInt::view(const uint64 *t_in, const uint64 *t_end, const uint64 **t_next) {
+	sizeT n = Limbs::recordLimbs(t_in, t_end);
+	BigIntView result;
+	result._value._data.borrow(t_in + 1, n);
+	result._value.sign = *t_in & 1;
+	if (t_next)
+		*t_next = t_in + 1 + n;
+	return result;
+}
+
+inline void BigInt::writeFile(const char *t_path, const BigInt *t_values, sizeT t_count) {
+	FILE *file = fopen(t_path, "wb");
+	if (!file)
+		throw std::runtime_error("Couldn't open file.");
+	uint64 header[2] = {Limbs::fileMagic, t_count};
+	bool ok = fwrite(header, sizeof(uint64), 2, file) == 2;
+	for (sizeT i = 0; ok && i < t_count; i++) {
+		sizeT n = *t_values[i].size;
+		uint64 word = (uint64) n << 1 | t_values[i].sign;
+		ok = fwrite(&word, sizeof(uint64), 1, file) == 1
+		     && fwrite(t_values[i]._data.data(), sizeof(uint64), n, file) == n;
+	}
+	if (fclose(file) != 0 || !ok)
+		throw std::runtime_error("Couldn't write file.");
+}
+
+inline Vector<BigInt> BigInt::readFile(const char *t_path) {
+	FILE *file = fopen(t_path, "rb");
+	if (!file)
+		throw std::runtime_error("Couldn't open file.");
+	// record sizes are checked against the words left, so a damaged header can't
+	// trigger a huge allocation
+	long bytes = -1;
+	if (fseek(file, 0, SEEK_END) == 0) {
+		bytes = ftell(file);
+		rewind(file);
+	}
+	uint64 header[2];
+	if (bytes < 0 || fread(header, sizeof(uint64), 2, file) != 2 || header[0] != Limbs::fileMagic
+	    || header[1] > (uint64) bytes / sizeof(uint64)) {
+		fclose(file);
+		throw std::runtime_error("Not a BigInt file.");
+	}
+	if (header[1] > Limbs::maxCount) {
+		fclose(file);
+		throw std::length_error("BigInt file has too many records.");
+	}
+	uint64 left = bytes / sizeof(uint64) - 2;
+	Vector<BigInt> result(header[1]);
+	for (sizeT i = 0; i < header[1]; i++) {
+		uint64 word;
+		bool ok = left > 0 && fread(&word, sizeof(uint64), 1, file) == 1 && (word >> 1) < left;
+		if (ok && (word >> 1) > Limbs::maxCount) {
+			fclose(file);
+			throw std::length_error("BigInt record is too long.");
+		}
+		if (ok) {
+			sizeT n = word >> 1;
+			left -= n + 1;
+			result[i]._data.resize(n);
+			ok = fread(result[i]._data.data(), sizeof(uint64), n, file) == n
+			     && (n == 0 ? !(word & 1) : result[i]._data.back() != 0);
+			result[i].sign = word & 1;
+		}
+		if (!ok) {
+			fclose(file);
+			throw std::runtime_error("BigInt file is damaged.");
+		}
+	}
+	fclose(file);
+	return result;
+}
+
+// Read-only mapping of a file written by BigInt::writeFile. The values are views into
+// the mapping, so opening costs one pass over the record headers and no limbs are copied.
+// The views returned by operator[] may not outlive the map
+
+class BigIntMap {
+	const uint64 *_words = nullptr;
+	size_t _bytes = 0;
+	// in words, which can go past sizeT in files over 32 GB
+	Vector<uint64> _offsets;
+	sizeT _count = 0;
+
+public:
+	const sizeT *size = &_count;
+
+	explicit BigIntMap(const char *t_path) {
+		int fd = open(t_path, O_RDONLY);
+		if (fd < 0)
+			throw std::runtime_error("Couldn't open file.");
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size < (off_t) (2 * sizeof(uint64))) {
+			close(fd);
+			throw std::runtime_error("Not a BigInt file.");
+		}
+		_bytes = info.st_size;
+		void *mapped = mmap(nullptr, _bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (mapped == MAP_FAILED)
+			throw std::runtime_error("Couldn't map file.");
+		_words = (const uint64 *) mapped;
+		try {
+			index();
+		} catch (...) {
+			munmap((void *) _words, _bytes);
+			throw;
+		}
+	}
+
+	BigIntMap(const BigIntMap &other) = delete;
+
+	BigIntMap &operator=(const BigIntMap &other) = delete;
+
+	~BigIntMap() {
+		munmap((void *) _words, _bytes);
+	}
+
+	BigIntView operator[](sizeT i) const {
+		if (i >= _count)
+			throw std::out_of_range("BigIntMap index out of range.");
+		return BigInt::view(_words + _offsets[i], _words + _bytes / sizeof(uint64));
+	}
+
+private:
+	void index() {
+		const uint64 *end = _words + _bytes / sizeof(uint64);
+		if (_words[0] != Limbs::fileMagic)
+			throw std::runtime_error("Not a BigInt file.");
+		uint64 count = _words[1];
+		if (count > (uint64) (end - _words - 2))
+			throw std::runtime_error("BigInt file is damaged.");
+		if (count > Limbs::maxCount)
+			throw std::length_error("BigInt file has too many records.");
+		_offsets.resize(count);
+		const uint64 *at = _words + 2;
+		for (sizeT i = 0; i < count; i++) {
+			_offsets[i] = at - _words;
+			at += 1 + Limbs::recordLimbs(at, end);
+		}
+		_count = count;
 	}
 };
 
@@ -0,0 +1,716 @@
+// Artem Mikheev 2020
+// GNU GPLv3 License
+
+#include "big.hpp"
+#include "string.hpp"
+#include <mutex>
+
+#ifndef BIG_FLOAT_HPP
+#define BIG_FLOAT_HPP
+
+// Arbitrary precision binary floating point number mantissa * 2^exponent with a BigInt
+// mantissa of at most precision bits. Results take the larger precision of the operands.
+// Addition, subtraction, multiplication, division and square root are correctly rounded
+// to nearest with ties to even. exp, log, sin and cos carry guard bits and are accurate
+// to about one unit in the last place. They evaluate their series by binary splitting,
+// so the work ends up in a few large BigInt multiplications
+
+class BigFloat {
+	BigInt _mantissa;
+	int64 _exponent = 0;
+	uint32 _precision;
+
+	static uint32 &defaultPrecisionSetting() {
+		static uint32 bits = 256;
+		return bits;
+	}
+
+	// extra working bits of the elementary functions
+	static uint32 guardBits(uint32 t_precision) {
+		return 32 + 2 * (32 - __builtin_clz(t_precision));
+	}
+
+	static uint64 trailingZeros(const BigInt &m) {
+		uint64 zeros = 0;
+		while (m._data[zeros >> 6] == 0)
+			zeros += 64;
+		return zeros + __builtin_ctzll(m._data[zeros >> 6]);
+	}
+
+	// m * 2^s rounded toward zero, keeping the sign of m
+	static BigInt shifted(const BigInt &m, int64 s) {
+		BigInt result;
+		if (s < 0) {
+			BigInt::shiftRightBits(&m, -s, &result);
+		} else if (*m.size) {
+			sizeT n = *m.size, limbs = s >> 6;
+			result._data.resize(n + limbs + 1);
+			Limbs::zero(result._data.data(), limbs);
+			if (s & 63)
+				result[n + limbs] = Limbs::shiftLeft(result._data.data() + limbs, m._data.data(), n, s & 63);
+			else
+				Limbs::copy(result._data.data() + limbs, m._data.data(), n);
+			result.removeLeadingZeros();
+		}
+		result.sign = *result.size ? m.sign : 0;
+		return result;
+	}
+
+	// rounds m * 2^e to t_precision bits, to nearest with ties to even,
+	// and strips the trailing zero bits so every value has one form
+	static void round(BigInt &m, int64 &e, uint32 t_precision) {
+		m.removeLeadingZeros();
+		if (*m.size == 0) {
+			m.sign = 0;
+			e = 0;
+			return;
+		}
+		uint64 bits = BigInt::bitLength(&m);
+		if (bits > t_precision) {
+			uint64 cut = bits - t_precision, zeros = trailingZeros(m);
+			bool half = (m[(cut - 1) >> 6] >> ((cut - 1) & 63)) & 1;
+			bool sticky = zeros < cut - 1;
+			ubyte sign = m.sign;
+			BigInt kept;
+			BigInt::shiftRightBits(&m, cut, &kept);
+			if (half && (sticky || (kept[0] & 1)))
+				kept += BigInt((uint64) 1);
+			kept.sign = sign;
+			m = std::move(kept);
+			e += cut;
+		}
+		uint64 zeros = trailingZeros(m);
+		if (zeros) {
+			m = shifted(m, -(int64) zeros);
+			e += zeros;
+		}
+	}
+
+	static BigFloat make(BigInt &&t_mantissa, int64 t_exponent, uint32 t_precision) {
+		BigFloat result((int64) 0, t_precision);
+		round(t_mantissa, t_exponent, t_precision);
+		result._mantissa = std::move(t_mantissa);
+		result._exponent = t_exponent;
+		return result;
+	}
+
+	// |this| < 2^top()
+	int64 top() const {
+		return _exponent + BigInt::bitLength(&_mantissa);
+	}
+
+	// a + b, or a - b if t_negate is set
+	static BigFloat addSigned(const BigFloat &a, const BigFloat &b, ubyte t_negate) {
+		uint32 p = Algorithm::max(a._precision, b._precision);
+		if (*b._mantissa.size == 0)
+			return BigFloat(a, p);
+		if (*a._mantissa.size == 0) {
+			BigFloat result(b, p);
+			result._mantissa.sign ^= t_negate;
+			return result;
+		}
+		ubyte signa = a._mantissa.sign, signb = b._mantissa.sign ^ t_negate;
+		const BigFloat *x = &a, *y = &b;
+		if (a.top() < b.top()) {
+			Algorithm::swap(x, y);
+			Algorithm::swap(signa, signb);
+		}
+		// a y entirely below the rounding position of x only matters as a sticky bit
+		int64 low = Algorithm::min(x->_exponent, x->top() - (int64) p - 3);
+		if (y->top() <= low) {
+			BigInt m = shifted(x->_mantissa, x->_exponent - low + 1);
+			m.sign = 0;
+			if (signa == signb)
+				m += BigInt((uint64) 1);
+			else
+				m -= BigInt((uint64) 1);
+			m.sign = signa;
+			return make(std::move(m), low - 1, p);
+		}
+		int64 e = Algorithm::min(x->_exponent, y->_exponent);
+		BigInt mx = shifted(x->_mantissa, x->_exponent - e), my = shifted(y->_mantissa, y->_exponent - e);
+		mx.sign = signa;
+		my.sign = signb;
+		return make(mx + my, e, p);
+	}
+
+	// (a * 2^ea) / (b * 2^eb) correctly rounded to t_precision bits
+	static BigFloat divide(const BigInt &a, int64 ea, const BigInt &b, int64 eb, uint32 t_precision) {
+		if (*b.size == 0)
+			throw std::runtime_error("Can't divide BigFloat by zero.");
+		if (*a.size == 0)
+			return BigFloat((int64) 0, t_precision);
+		int64 k = Algorithm::max((int64) 0, (int64) t_precision + 3 + (int64) BigInt::bitLength(&b) - (int64) BigInt::bitLength(&a));
+		BigInt num = shifted(a, k), den(b);
+		num.sign = den.sign = 0;
+		BigInt q = num / den;
+		num.submul(q, den);
+		int64 e = ea - eb - k;
+		// a nonzero remainder lands below the rounding position as a sticky bit
+		if (*num.size) {
+			q = shifted(q, 1) + BigInt((uint64) 1);
+			e--;
+		}
+		q.sign = a.sign ^ b.sign;
+		return make(std::move(q), e, t_precision);
+	}
+
+	static int cmp(const BigFloat &a, const BigFloat &b) {
+		int sa = *a._mantissa.size == 0 ? 0 : (a._mantissa.sign ? -1 : 1);
+		int sb = *b._mantissa.size == 0 ? 0 : (b._mantissa.sign ? -1 : 1);
+		if (sa != sb || sa == 0)
+			return sa < sb ? -1 : (sa > sb ? 1 : 0);
+		int magnitude;
+		if (a.top() != b.top()) {
+			magnitude = a.top() < b.top() ? -1 : 1;
+		} else {
+			int64 e = Algorithm::min(a._exponent, b._exponent);
+			BigInt ma = shifted(a._mantissa, a._exponent - e), mb = shifted(b._mantissa, b._exponent - e);
+			ma.sign = mb.sign = 0;
+			magnitude = ma == mb ? 0 : (ma < mb ? -1 : 1);
+		}
+		return sa * magnitude;
+	}
+
+	// Binary splitting of the sum over n in [t_from, t_to) of a(n) / b(n) * prod p(i) / q(i)
+	// for i from t_from to n. t_term(n, a, b, p, q) gives the factors of term n and
+	// the sum is t / (b q) on return
+	template<typename F>
+	static void splitSeries(const F &t_term, uint64 t_from, uint64 t_to, BigInt &p, BigInt &q, BigInt &b, BigInt &t) {
+		if (t_to - t_from == 1) {
+			BigInt a;
+			t_term(t_from, a, b, p, q);
+			t = a * p;
+			return;
+		}
+		uint64 mid = (t_from + t_to) / 2;
+		BigInt p2, q2, b2, t2;
+		splitSeries(t_term, t_from, mid, p, q, b, t);
+		splitSeries(t_term, mid, t_to, p2, q2, b2, t2);
+		t = t * q2 * b2;
+		t.addmul(p * b, t2);
+		p = p * p2;
+		q = q * q2;
+		b = b * b2;
+	}
+
+	template<typename F>
+	static BigFloat sumSeries(const F &t_term, uint64 t_count, uint32 t_precision) {
+		BigInt p, q, b, t;
+		splitSeries(t_term, 0, t_count, p, q, b, t);
+		return divide(t, 0, b * q, 0, t_precision);
+	}
+
+	// terms needed until x^n / (n!) with |x| < 2^-t_bits drops below 2^-t_precision,
+	// t_step is 2 for the series of cos and sin
+	static uint64 termCount(uint64 t_bits, uint32 t_precision, uint32 t_step) {
+		long double drop = 0;
+		uint64 n = 0;
+		while (drop < t_precision + 4) {
+			n++;
+			drop += t_step * t_bits;
+			for (uint32 i = 0; i < t_step; i++)
+				drop += log2l((long double) (t_step * n - i));
+		}
+		return n + 1;
+	}
+
+	// The top t_precision bits of |r| < 1, counted from its leading bit so that small r keep
+	// all of theirs, split into chunks that double in length. t_chunk(m, bits, start) gets
+	// the chunk value m * 2^-bits, whose absolute value is below 2^-start, with the sign of r.
+	// Series for a chunk of k bits need about precision / k terms of k bits each, so every
+	// chunk costs about the same
+	template<typename F>
+	static void forChunks(const BigFloat &r, uint32 t_precision, const F &t_chunk) {
+		uint64 skip = Algorithm::max((int64) 0, -r.top());
+		BigInt fixed = shifted(r._mantissa, r._exponent + (int64) skip + t_precision), previous;
+		ubyte sign = fixed.sign;
+		fixed.sign = 0;
+		uint64 done = 0;
+		for (uint64 length = 8; done < t_precision; length *= 2) {
+			uint64 end = Algorithm::min(done + length, (uint64) t_precision);
+			BigInt high = shifted(fixed, -(int64) (t_precision - end));
+			BigInt m = high - shifted(previous, end - done);
+			previous = std::move(high);
+			if (*m.size) {
+				m.sign = sign;
+				t_chunk(m, skip + end, skip + done);
+			}
+			done = end;
+		}
+	}
+
+	// exp(r) for |r| < 1 as the product of the exponentials of the chunks of r
+	static BigFloat expReduced(const BigFloat &r, uint32 t_precision) {
+		BigFloat result((int64) 1, t_precision);
+		forChunks(r, t_precision, [&](const BigInt &m, uint64 t_bits, uint64 t_start) {
+			BigInt one((uint64) 1);
+			auto term = [&](uint64 n, BigInt &a, BigInt &b, BigInt &p, BigInt &q) {
+				a = one;
+				b = one;
+				p = n ? m : one;
+				q = n ? shifted(BigInt(n), t_bits) : one;
+			};
+			result = result * sumSeries(term, termCount(t_start, t_precision, 1), t_precision);
+		});
+		return result;
+	}
+
+	// cos(r) and sin(r) for |r| < 1, combining the chunks of r with the angle addition formulas
+	static void cosSinReduced(const BigFloat &r, uint32 t_precision, BigFloat &t_cos, BigFloat &t_sin) {
+		t_cos = BigFloat((int64) 1, t_precision);
+		t_sin = BigFloat((int64) 0, t_precision);
+		forChunks(r, t_precision, [&](const BigInt &m, uint64 t_bits, uint64 t_start) {
+			BigInt one((uint64) 1), square = m * m;
+			square.sign = 1;
+			uint64 count = termCount(t_start, t_precision, 2);
+			// sum of (-x^2)^n / (2n)! and of (-x^2)^n / (2n + 1)!
+			auto cosTerm = [&](uint64 n, BigInt &a, BigInt &b, BigInt &p, BigInt &q) {
+				a = one;
+				b = one;
+				p = n ? square : one;
+				q = n ? shifted(BigInt((2 * n - 1) * (2 * n)), 2 * t_bits) : one;
+			};
+			auto sinTerm = [&](uint64 n, BigInt &a, BigInt &b, BigInt &p, BigInt &q) {
+				a = one;
+				b = one;
+				p = n ? square : one;
+				q = n ? shifted(BigInt((2 * n) * (2 * n + 1)), 2 * t_bits) : one;
+			};
+			BigFloat c = sumSeries(cosTerm, count, t_precision);
+			BigFloat s = sumSeries(sinTerm, count, t_precision) * make(BigInt(m), -(int64) t_bits, t_precision);
+			BigFloat nextCos = t_cos * c - t_sin * s;
+			t_sin = t_sin * c + t_cos * s;
+			t_cos = std::move(nextCos);
+		});
+	}
+
+	// atanh(1 / t_q) = sum of 1 / ((2n + 1) q^(2n + 1))
+	static BigFloat atanhInverse(uint64 t_q, uint32 t_precision) {
+		BigInt one((uint64) 1), square = BigInt(t_q) * BigInt(t_q);
+		auto term = [&](uint64 n, BigInt &a, BigInt &b, BigInt &p, BigInt &q) {
+			a = one;
+			b = BigInt(2 * n + 1);
+			p = one;
+			q = n ? square : BigInt(t_q);
+		};
+		// each term gains 2 log2(q) bits
+		uint64 count = (uint64) (t_precision / (2 * log2l((long double) t_q))) + 2;
+		return sumSeries(term, count, t_precision);
+	}
+
+	// x - k * c for the k nearest to x / c, with c computed by t_constant at enough
+	// precision that the result keeps t_precision bits even when x is close to k * c
+	template<typename F>
+	BigFloat reduce(const F &t_constant, uint32 t_precision, int64 &k) const {
+		BigFloat c = t_constant(64);
+		long double ratio = toLongDouble() / c.toLongDouble();
+		if (!(fabsl(ratio) < 9.2e18L))
+			throw std::runtime_error("BigFloat argument is too large to reduce.");
+		k = llroundl(ratio);
+		uint32 extra = k ? 64 - __builtin_clzll(k < 0 ? -k : k) : 0;
+		for (uint32 precision = t_precision + extra;;) {
+			BigFloat x(*this, precision + Algorithm::max((int64) 0, top()));
+			BigFloat r = k ? x - t_constant(precision) * BigFloat(k, precision) : x;
+			// retry with more bits if the subtraction cancelled too many of them
+			int64 lost = *r._mantissa.size ? -r.top() : 0;
+			if (lost <= 8 || precision > t_precision + extra + lost)
+				return BigFloat(r, t_precision);
+			precision = t_precision + extra + lost + 16;
+		}
+	}
+
+public:
+	// the precision of values created without one
+	static void setDefaultPrecision(uint32 t_bits) {
+		if (t_bits < 2)
+			throw std::logic_error("BigFloat precision must be at least 2 bits.");
+		defaultPrecisionSetting() = t_bits;
+	}
+
+	static uint32 defaultPrecision() {
+		return defaultPrecisionSetting();
+	}
+
+	BigFloat()
+		: _precision(defaultPrecision()) {}
+
+	BigFloat(int64 t_value, uint32 t_precision = defaultPrecision())
+		: _mantissa(t_value),
+		  _precision(t_precision) {
+		round(_mantissa, _exponent, _precision);
+	}
+
+	BigFloat(const BigInt &t_value, uint32 t_precision = defaultPrecision())
+		: _mantissa(t_value),
+		  _precision(t_precision) {
+		round(_mantissa, _exponent, _precision);
+	}
+
+	// exact for every finite long double that fits the precision
+	BigFloat(long double t_value, uint32 t_precision = defaultPrecision())
+		: _precision(t_precision) {
+		if (!std::isfinite(t_value))
+			throw std::runtime_error("Can't convert infinity or NaN to BigFloat.");
+		int exponent;
+		long double fraction = frexpl(fabsl(t_value), &exponent);
+		_mantissa = BigInt((uint64) ldexpl(fraction, 64));
+		_mantissa.sign = t_value < 0;
+		_exponent = exponent - 64;
+		round(_mantissa, _exponent, _precision);
+	}
+
+	// decimal notation like -12.5e-3, correctly rounded
+	BigFloat(const String &t_value, uint32 t_precision = defaultPrecision())
+		: _precision(t_precision) {
+		sizeT n = *t_value.size, i = 0;
+		ubyte sign = n > 0 && t_value[0] == U'-';
+		i = sign || (n > 0 && t_value[0] == U'+');
+		String digits(n);
+		sizeT count = 0;
+		int64 exponent10 = 0;
+		bool point = false;
+		for (; i < n && t_value[i] != U'e' && t_value[i] != U'E'; i++) {
+			if (t_value[i] == U'.' && !point) {
+				point = true;
+			} else if (t_value[i] >= U'0' && t_value[i] <= U'9') {
+				digits[count++] = t_value[i];
+				exponent10 -= point;
+			} else {
+				throw std::runtime_error("Cannot convert non-numeric string to BigFloat.");
+			}
+		}
+		if (count == 0)
+			throw std::runtime_error("Cannot convert non-numeric string to BigFloat.");
+		if (i < n) {
+			ubyte negative = i + 1 < n && t_value[i + 1] == U'-';
+			int64 value = 0;
+			sizeT start = i + 1 + (negative || (i + 1 < n && t_value[i + 1] == U'+'));
+			if (start == n)
+				throw std::runtime_error("Cannot convert non-numeric string to BigFloat.");
+			for (i = start; i < n; i++) {
+				if (t_value[i] < U'0' || t_value[i] > U'9' || value > 1000000000000LL)
+					throw std::runtime_error("Cannot convert non-numeric string to BigFloat.");
+				value = value * 10 + (t_value[i] - U'0');
+			}
+			exponent10 += negative ? -value : value;
+		}
+		digits.resize(count);
+		BigInt mantissa(digits);
+		mantissa.sign = sign;
+		if (exponent10 >= 0) {
+			if (exponent10 > 0)
+				mantissa = mantissa * BigInt::powUInt(BigInt((uint64) 10), exponent10);
+			round(mantissa, _exponent, _precision);
+			_mantissa = std::move(mantissa);
+		} else {
+			*this = divide(mantissa, 0, BigInt::powUInt(BigInt((uint64) 10), -exponent10), 0, _precision);
+		}
+	}
+
+	// the value rounded to t_precision bits
+	BigFloat(const BigFloat &other, uint32 t_precision)
+		: _mantissa(other._mantissa),
+		  _exponent(other._exponent),
+		  _precision(t_precision) {
+		round(_mantissa, _exponent, _precision);
+	}
+
+	BigFloat(const BigFloat &other) = default;
+
+	BigFloat(BigFloat &&other) = default;
+
+	BigFloat &operator=(const BigFloat &other) = default;
+
+	BigFloat &operator=(BigFloat &&other) = default;
+
+	uint32 precision() const {
+		return _precision;
+	}
+
+	void setPrecision(uint32 t_bits) {
+		_precision = t_bits;
+		round(_mantissa, _exponent, _precision);
+	}
+
+	// the value is mantissa() * 2^exponent(), with an odd mantissa unless it is 0
+	const BigInt &mantissa() const {
+		return _mantissa;
+	}
+
+	int64 exponent() const {
+		return _exponent;
+	}
+
+	bool isZero() const {
+		return *_mantissa.size == 0;
+	}
+
+	bool isNegative() const {
+		return _mantissa.sign;
+	}
+
+	long double toLongDouble() const {
+		if (isZero())
+			return 0;
+		uint64 bits = BigInt::bitLength(&_mantissa);
+		BigInt lead = shifted(_mantissa, bits > 64 ? 64 - (int64) bits : 0);
+		long double value = ldexpl((long double) lead[0], _exponent + (bits > 64 ? bits - 64 : 0));
+		return _mantissa.sign ? -value : value;
+	}
+
+	// rounded toward zero
+	BigInt toBigInt() const {
+		return shifted(_mantissa, _exponent);
+	}
+
+	// t_digits significant decimal digits, rounded to nearest, in the form -1.2345e-67.
+	// 0 digits means as many as the precision holds
+	String toString(uint32 t_digits = 0) const {
+		if (isZero())
+			return String((sizeT) 1, '0');
+		uint32 digits = t_digits ? t_digits : Algorithm::max((uint32) 1, (uint32) (_precision * 0.30102999566L));
+		long double log2 = BigInt::log2Abs(&_mantissa) + _exponent;
+		int64 exponent10 = (int64) floorl(log2 * 0.30102999566398119521L);
+		BigInt ten((uint64) 10), value;
+		String text;
+		// the estimate of the decimal exponent can be off by one either way
+		for (int attempt = 0; attempt < 3; attempt++) {
+			int64 k = (int64) digits - 1 - exponent10;
+			BigInt num = _mantissa, den((uint64) 1);
+			num.sign = 0;
+			if (k > 0)
+				num = num * BigInt::powUInt(ten, k);
+			else if (k < 0)
+				den = BigInt::powUInt(ten, -k);
+			if (_exponent >= 0)
+				num = shifted(num, _exponent);
+			else
+				den = shifted(den, -_exponent);
+			value = (shifted(num, 1) + den) / shifted(den, 1);
+			String candidate = value.getValue();
+			if (*candidate.size > digits) {
+				exponent10++;
+			} else if (*candidate.size < digits) {
+				exponent10--;
+			} else {
+				text = candidate;
+				break;
+			}
+		}
+		String exponentText = exponent10 ? intToString((int) exponent10) : String();
+		String result((sizeT) (_mantissa.sign + digits + (digits > 1) + (exponent10 ? 1 + *exponentText.size : 0)));
+		sizeT at = 0;
+		if (_mantissa.sign)
+			result[at++] = U'-';
+		for (sizeT i = 0; i < digits; i++) {
+			result[at++] = text[i];
+			if (i == 0 && digits > 1)
+				result[at++] = U'.';
+		}
+		if (exponent10) {
+			result[at++] = U'e';
+			for (sizeT i = 0; i < *exponentText.size; i++)
+				result[at++] = exponentText[i];
+		}
+		return result;
+	}
+
+	BigFloat operator+(const BigFloat &other) const {
+		return addSigned(*this, other, 0);
+	}
+
+	BigFloat operator-(const BigFloat &other) const {
+		return addSigned(*this, other, 1);
+	}
+
+	BigFloat operator-() const {
+		BigFloat result(*this);
+		if (*result._mantissa.size)
+			result._mantissa.sign ^= 1;
+		return result;
+	}
+
+	BigFloat operator*(const BigFloat &other) const {
+		return make(_mantissa * other._mantissa, _exponent + other._exponent, Algorithm::max(_precision, other._precision));
+	}
+
+	BigFloat operator/(const BigFloat &other) const {
+		return divide(_mantissa, _exponent, other._mantissa, other._exponent, Algorithm::max(_precision, other._precision));
+	}
+
+	BigFloat &operator+=(const BigFloat &other) {
+		return *this = *this + other;
+	}
+
+	BigFloat &operator-=(const BigFloat &other) {
+		return *this = *this - other;
+	}
+
+	BigFloat &operator*=(const BigFloat &other) {
+		return *this = *this * other;
+	}
+
+	BigFloat &operator/=(const BigFloat &other) {
+		return *this = *this / other;
+	}
+
+	// this * 2^t_shift, exact
+	BigFloat ldexp(int64 t_shift) const {
+		BigFloat result(*this);
+		if (*result._mantissa.size)
+			result._exponent += t_shift;
+		return result;
+	}
+
+	bool operator==(const BigFloat &other) const {
+		return cmp(*this, other) == 0;
+	}
+
+	bool operator!=(const BigFloat &other) const {
+		return cmp(*this, other) != 0;
+	}
+
+	bool operator<(const BigFloat &other) const {
+		return cmp(*this, other) < 0;
+	}
+
+	bool operator>(const BigFloat &other) const {
+		return cmp(*this, other) > 0;
+	}
+
+	bool operator<=(const BigFloat &other) const {
+		return cmp(*this, other) <= 0;
+	}
+
+	bool operator>=(const BigFloat &other) const {
+		return cmp(*this, other) >= 0;
+	}
+
+	// correctly rounded through the integer square root of the scaled mantissa
+	BigFloat sqrt() const {
+		if (_mantissa.sign)
+			throw std::runtime_error("Square root of a negative BigFloat.");
+		if (isZero())
+			return *this;
+		int64 k = Algorithm::max((int64) 0, 2 * (int64) _precision + 4 - (int64) BigInt::bitLength(&_mantissa));
+		if ((_exponent - k) & 1)
+			k++;
+		bool exact;
+		BigInt root = shifted(_mantissa, k).isqrt(&exact);
+		int64 e = (_exponent - k) / 2;
+		if (!exact) {
+			root = shifted(root, 1) + BigInt((uint64) 1);
+			e--;
+		}
+		return make(std::move(root), e, _precision);
+	}
+
+	// pi by the Chudnovsky series, cached at the largest precision asked for so far.
+	// Callers from other threads wait while the cache grows
+	static BigFloat pi(uint32 t_precision = defaultPrecision()) {
+		static BigFloat cached((int64) 0, 0);
+		static std::mutex mutex;
+		std::lock_guard<std::mutex> lock(mutex);
+		if (cached._precision < t_precision) {
+			uint32 precision = t_precision + guardBits(t_precision);
+			BigInt one((uint64) 1), c3((uint64) 10939058860032000ULL);
+			auto term = [&](uint64 n, BigInt &a, BigInt &b, BigInt &p, BigInt &q) {
+				a = BigInt((uint64) (13591409 + 545140134 * n));
+				b = one;
+				if (n == 0) {
+					p = one;
+					q = one;
+				} else {
+					p = BigInt((uint64) ((6 * n - 5) * (2 * n - 1) * (6 * n - 1)));
+					p.sign = 1;
+					q = BigInt(n) * BigInt(n) * BigInt(n) * c3;
+				}
+			};
+			// each term adds about 47.11 bits
+			BigFloat sum = sumSeries(term, precision / 47 + 2, precision);
+			cached = BigFloat((int64) 426880, precision) * BigFloat((int64) 10005, precision).sqrt() / sum;
+		}
+		return BigFloat(cached, t_precision);
+	}
+
+	// ln 2 = 18 atanh(1/26) - 2 atanh(1/4801) + 8 atanh(1/8749), cached like pi
+	static BigFloat ln2(uint32 t_precision = defaultPrecision()) {
+		static BigFloat cached((int64) 0, 0);
+		static std::mutex mutex;
+		std::lock_guard<std::mutex> lock(mutex);
+		if (cached._precision < t_precision) {
+			uint32 precision = t_precision + guardBits(t_precision);
+			cached = atanhInverse(26, precision) * BigFloat((int64) 18, precision)
+			         - atanhInverse(4801, precision) * BigFloat((int64) 2, precision)
+			         + atanhInverse(8749, precision) * BigFloat((int64) 8, precision);
+		}
+		return BigFloat(cached, t_precision);
+	}
+
+	BigFloat exp() const {
+		if (isZero())
+			return BigFloat((int64) 1, _precision);
+		uint32 precision = _precision + guardBits(_precision);
+		int64 k;
+		BigFloat r = reduce([](uint32 t_bits) { return ln2(t_bits); }, precision, k);
+		return BigFloat(expReduced(r, precision).ldexp(k), _precision);
+	}
+
+	// Newton steps y + x exp(-y) - 1 from a long double estimate, doubling the precision each time
+	BigFloat log() const {
+		if (isZero() || _mantissa.sign)
+			throw std::runtime_error("Logarithm of a non-positive BigFloat.");
+		uint32 precision = _precision + guardBits(_precision);
+		// x = y * 2^shift with y in [0.75, 1.5)
+		int64 shift = top() - 1;
+		BigFloat y = ldexp(-shift);
+		if (y > BigFloat(1.5L, 8)) {
+			shift++;
+			y = y.ldexp(-1);
+		}
+		// log y is about y - 1, which fixes how many of its bits are significant
+		BigFloat nearOne = y - BigFloat((int64) 1, precision);
+		if (nearOne.isZero())
+			return shift ? BigFloat(ln2(precision) * BigFloat(shift, precision), _precision) : BigFloat((int64) 0, _precision);
+		precision += Algorithm::max((int64) 0, -nearOne.top());
+		Vector<uint32> stages;
+		for (uint32 bits = precision; bits > 48; bits = bits / 2 + 16)
+			stages.push(bits);
+		BigFloat result(logl(y.toLongDouble()), 64);
+		for (sizeT i = *stages.size; i-- > 0;) {
+			uint32 bits = stages[i];
+			BigFloat current(result, bits);
+			result = current + BigFloat(y, bits) * (-current).exp() - BigFloat((int64) 1, bits);
+		}
+		if (shift)
+			result = result + ln2(precision) * BigFloat(shift, precision);
+		return BigFloat(result, _precision);
+	}
+
+	BigFloat sin() const {
+		if (isZero())
+			return *this;
+		uint32 precision = _precision + guardBits(_precision);
+		int64 k;
+		BigFloat r = reduce([](uint32 t_bits) { return pi(t_bits).ldexp(-1); }, precision, k);
+		BigFloat c, s;
+		cosSinReduced(r, precision, c, s);
+		BigFloat result = (k & 1) ? c : s;
+		return BigFloat((k & 2) ? -result : result, _precision);
+	}
+
+	BigFloat cos() const {
+		if (isZero())
+			return BigFloat((int64) 1, _precision);
+		uint32 precision = _precision + guardBits(_precision);
+		int64 k;
+		BigFloat r = reduce([](uint32 t_bits) { return pi(t_bits).ldexp(-1); }, precision, k);
+		BigFloat c, s;
+		cosSinReduced(r, precision, c, s);
+		BigFloat result = (k & 1) ? s : c;
+		return BigFloat(((k + 1) & 2) ? -result : result, _precision);
+	}
+};
+
+#endif //BIG_FLOAT_HPP
@@ -0,0 +1,570 @@
+// Artem Mikheev 2020
+// GNU GPLv3 License
+
+#include "complex.hpp"
+#include "vector.hpp"
+#include "vartypes.hpp"
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#ifndef COMPLEX_ARRAY_HPP
+#define COMPLEX_ARRAY_HPP
+
+// Array of complex numbers kept as two separate arrays of real and imaginary parts
+// (structure of arrays), so that element-wise arithmetic over float and double runs on
+// whole vectors of parts at once with the widest registers the processor has (AVX-512,
+// AVX2 with FMA or SSE2, picked at run time). Both arrays start on 64-byte boundaries
+
+namespace ComplexLanes {
+	template<typename T, int Bytes>
+	struct Width {
+		typedef T real __attribute__((vector_size(Bytes)));
+		static const int count = Bytes / sizeof(T);
+	};
+
+	// lane by lane through <cmath> unless the instruction set has a square root
+	// for the whole vector. std::sqrt sets errno, so the compiler won't vectorise it.
+	// The AVX ones can't be always_inline, as the kernels calling them have no target
+	// of their own, and are inlined into the runners below once the kernels are
+	template<typename V>
+	__attribute__((always_inline)) inline void squareRoot(V &x) {
+		for (size_t i = 0; i < sizeof(V) / sizeof(x[0]); i++)
+			x[i] = std::sqrt(x[i]);
+	}
+
+#if defined(__x86_64__) || defined(__i386__)
+	__attribute__((always_inline)) inline void squareRoot(Width<double, 16>::real &x) {
+		x = (Width<double, 16>::real) _mm_sqrt_pd((__m128d) x);
+	}
+
+	__attribute__((always_inline)) inline void squareRoot(Width<float, 16>::real &x) {
+		x = (Width<float, 16>::real) _mm_sqrt_ps((__m128) x);
+	}
+
+	__attribute__((target("avx2"))) inline void squareRoot(Width<double, 32>::real &x) {
+		x = (Width<double, 32>::real) _mm256_sqrt_pd((__m256d) x);
+	}
+
+	__attribute__((target("avx2"))) inline void squareRoot(Width<float, 32>::real &x) {
+		x = (Width<float, 32>::real) _mm256_sqrt_ps((__m256) x);
+	}
+
+	// masked with every lane set, as the unmasked one starts from an undefined vector
+	// that -Wall takes for an uninitialised one
+	__attribute__((target("avx512f"))) inline void squareRoot(Width<double, 64>::real &x) {
+		x = (Width<double, 64>::real) _mm512_maskz_sqrt_pd(0xff, (__m512d) x);
+	}
+
+	__attribute__((target("avx512f"))) inline void squareRoot(Width<float, 64>::real &x) {
+		x = (Width<float, 64>::real) _mm512_maskz_sqrt_ps(0xffff, (__m512) x);
+	}
+#endif
+
+	// products and sums are contracted into fused multiply-adds wherever the target
+	// has them, which is both faster and rounds once instead of twice
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=fast")
+
+	template<typename V, typename T>
+	__attribute__((always_inline)) inline void load(V &x, const T *t_from) {
+		memcpy(&x, t_from, sizeof(V));
+	}
+
+	template<typename V, typename T>
+	__attribute__((always_inline)) inline void store(T *t_to, const V &x) {
+		memcpy(t_to, &x, sizeof(V));
+	}
+
+	// element-wise kernels over (ar, ai) and (br, bi) into (outr, outi), which may be
+	// either of the inputs. The last few elements go through one zero-padded block
+	template<typename K>
+	struct Binary {
+		template<typename W, typename T>
+		__attribute__((always_inline)) static inline void run(const T *ar, const T *ai, const T *br, const T *bi,
+		                                                      T *outr, T *outi, size_t n) {
+			size_t i = 0;
+			for (; i + W::count <= n; i += W::count)
+				K::template block<typename W::real>(ar + i, ai + i, br + i, bi + i, outr + i, outi + i);
+			if (i < n) {
+				T x[4][W::count] = {}, yr[W::count] = {}, yi[W::count] = {};
+				memcpy(x[0], ar + i, (n - i) * sizeof(T));
+				memcpy(x[1], ai + i, (n - i) * sizeof(T));
+				memcpy(x[2], br + i, (n - i) * sizeof(T));
+				memcpy(x[3], bi + i, (n - i) * sizeof(T));
+				if (K::accumulates) {
+					memcpy(yr, outr + i, (n - i) * sizeof(T));
+					memcpy(yi, outi + i, (n - i) * sizeof(T));
+				}
+				K::template block<typename W::real>(x[0], x[1], x[2], x[3], yr, yi);
+				memcpy(outr + i, yr, (n - i) * sizeof(T));
+				memcpy(outi + i, yi, (n - i) * sizeof(T));
+			}
+		}
+	};
+
+	template<bool Subtract>
+	struct AddKernel {
+		static const bool accumulates = false;
+
+		template<typename V, typename T>
+		__attribute__((always_inline)) static inline void block(const T *ar, const T *ai, const T *br, const T *bi,
+		                                                        T *outr, T *outi) {
+			V xr, xi, yr, yi;
+			load(xr, ar);
+			load(xi, ai);
+			load(yr, br);
+			load(yi, bi);
+			store(outr, Subtract ? xr - yr : xr + yr);
+			store(outi, Subtract ? xi - yi : xi + yi);
+		}
+	};
+
+	struct MultiplyKernel {
+		static const bool accumulates = false;
+
+		template<typename V, typename T>
+		__attribute__((always_inline)) static inline void block(const T *ar, const T *ai, const T *br, const T *bi,
+		                                                        T *outr, T *outi) {
+			V xr, xi, yr, yi;
+			load(xr, ar);
+			load(xi, ai);
+			load(yr, br);
+			load(yi, bi);
+			store(outr, xr * yr - xi * yi);
+			store(outi, xr * yi + xi * yr);
+		}
+	};
+
+	// out += a * b
+	struct MultiplyAddKernel {
+		static const bool accumulates = true;
+
+		template<typename V, typename T>
+		__attribute__((always_inline)) static inline void block(const T *ar, const T *ai, const T *br, const T *bi,
+		                                                        T *outr, T *outi) {
+			V xr, xi, yr, yi;
+			load(xr, ar);
+			load(xi, ai);
+			load(yr, br);
+			load(yi, bi);
+			V zr, zi;
+			load(zr, outr);
+			load(zi, outi);
+			zr += xr * yr;
+			zi += xr * yi;
+			zr -= xi * yi;
+			zi += xi * yr;
+			store(outr, zr);
+			store(outi, zi);
+		}
+	};
+
+	// out = -in, for the imaginary parts of the conjugate
+	struct NegateKernel {
+		template<typename W, typename T>
+		__attribute__((always_inline)) static inline void run(const T *in, T *out, size_t n) {
+			size_t i = 0;
+			for (; i + W::count <= n; i += W::count) {
+				typename W::real x;
+				load(x, in + i);
+				store(out + i, -x);
+			}
+			for (; i < n; i++)
+				out[i] = -in[i];
+		}
+	};
+
+	// |a| as the square root of re^2 + im^2. |re| + |im| is within a factor of two of |a|,
+	// so where it is outside [2^-510, 2^510] ([2^-62, 2^62] for float) and not zero, the
+	// sum of squares may have overflowed or lost bits to underflow, and those lanes are
+	// recomputed with std::hypot, which scales first. The range is checked on the bits
+	// with integer arithmetic alone: or-ed comparisons in kernels without a target of their
+	// own are expanded lane by lane before they are inlined into the runners
+	struct MagnitudeKernel {
+		template<typename V, typename T>
+		__attribute__((always_inline)) static inline void block(const T *ar, const T *ai, T *out) {
+			typedef decltype(V() < V()) I;
+			const bool single = sizeof(T) == sizeof(float);
+			V xr, xi;
+			load(xr, ar);
+			load(xi, ai);
+			V r = xr * xr + xi * xi;
+			squareRoot(r);
+			store(out, r);
+			I sign = (I) -V{};
+			I low = (I) (V{} + (single ? (T) 0x1p-62 : (T) 0x1p-510));
+			I high = (I) (V{} + (single ? (T) 0x1p62 : (T) 0x1p510));
+			I u = (I) ((V) ((I) xr & ~sign) + (V) ((I) xi & ~sign));
+			// the sign bit of u - low is set below the range, of high - u above it
+			// (infinities and NaNs included) and of -u unless u is zero
+			I special = (((u - low) & -u) | (high - u)) & sign;
+			if (Math::Lanes::any(special))
+				for (size_t k = 0; k < sizeof(V) / sizeof(T); k++)
+					if (special[k])
+						out[k] = std::hypot(ar[k], ai[k]);
+		}
+
+		template<typename W, typename T>
+		__attribute__((always_inline)) static inline void run(const T *ar, const T *ai, T *out, size_t n) {
+			size_t i = 0;
+			for (; i + W::count <= n; i += W::count)
+				block<typename W::real>(ar + i, ai + i, out + i);
+			if (i < n) {
+				T xr[W::count] = {}, xi[W::count] = {}, y[W::count];
+				memcpy(xr, ar + i, (n - i) * sizeof(T));
+				memcpy(xi, ai + i, (n - i) * sizeof(T));
+				block<typename W::real>(xr, xi, y);
+				memcpy(out + i, y, (n - i) * sizeof(T));
+			}
+		}
+	};
+
+	// sum of a * b, or of conj(a) * b. The four products are summed separately, so
+	// that the additions of one block don't wait for those of the previous one
+	template<bool Conjugate>
+	struct DotKernel {
+		template<typename W, typename T>
+		__attribute__((always_inline)) static inline void run(const T *ar, const T *ai, const T *br, const T *bi,
+		                                                      T *re, T *im, size_t n) {
+			typedef typename W::real V;
+			V rr = {}, ii = {}, ri = {}, ir = {};
+			size_t i = 0;
+			for (; i + W::count <= n; i += W::count) {
+				V xr, xi, yr, yi;
+				load(xr, ar + i);
+				load(xi, ai + i);
+				load(yr, br + i);
+				load(yi, bi + i);
+				rr += xr * yr;
+				ii += xi * yi;
+				ri += xr * yi;
+				ir += xi * yr;
+			}
+			if (i < n) {
+				T x[4][W::count] = {};
+				memcpy(x[0], ar + i, (n - i) * sizeof(T));
+				memcpy(x[1], ai + i, (n - i) * sizeof(T));
+				memcpy(x[2], br + i, (n - i) * sizeof(T));
+				memcpy(x[3], bi + i, (n - i) * sizeof(T));
+				V xr, xi, yr, yi;
+				load(xr, x[0]);
+				load(xi, x[1]);
+				load(yr, x[2]);
+				load(yi, x[3]);
+				rr += xr * yr;
+				ii += xi * yi;
+				ri += xr * yi;
+				ir += xi * yr;
+			}
+			V sr = Conjugate ? rr + ii : rr - ii;
+			V si = Conjugate ? ri - ir : ri + ir;
+			*re = *im = 0;
+			for (int k = 0; k < W::count; k++) {
+				*re += sr[k];
+				*im += si[k];
+			}
+		}
+	};
+
+#pragma GCC pop_options
+
+#if defined(__x86_64__) || defined(__i386__)
+	template<typename K, typename T, typename... A>
+	__attribute__((target("avx512f"))) void runAvx512(A... t_args) {
+		K::template run<Width<T, 64>>(t_args...);
+	}
+
+	template<typename K, typename T, typename... A>
+	__attribute__((target("avx2,fma"))) void runAvx2(A... t_args) {
+		K::template run<Width<T, 32>>(t_args...);
+	}
+#endif
+
+	template<typename K, typename T, typename... A>
+	void runAll(A... t_args) {
+#if defined(__x86_64__) || defined(__i386__)
+		static const int level = __builtin_cpu_supports("avx512f")
+		                         ? 2 : (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ? 1 : 0);
+		if (level == 2)
+			return runAvx512<K, T>(t_args...);
+		if (level == 1)
+			return runAvx2<K, T>(t_args...);
+#endif
+		K::template run<Width<T, 16>>(t_args...);
+	}
+}
+
+template<typename T>
+class ComplexArray {
+	// float and double go through ComplexLanes, anything else element by element
+	static const bool _lanes = std::is_same<T, float>::value || std::is_same<T, double>::value;
+	static const size_t _alignment = 64;
+
+	T *_re = nullptr;
+	T *_im = nullptr;
+	sizeT _size = 0;
+	sizeT _capacity = 0;
+
+	static T *allocate(sizeT n) {
+		return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(_alignment)));
+	}
+
+	static void deallocate(T *p) {
+		::operator delete(p, std::align_val_t(_alignment));
+	}
+
+	void release() {
+		if (_re != nullptr) {
+			deallocate(_re);
+			deallocate(_im);
+		}
+		_re = _im = nullptr;
+		_size = _capacity = 0;
+	}
+
+	// capacity in whole 64-byte lines, so that the arrays could be read in whole vectors
+	void reserve(sizeT n) {
+		if (n <= _capacity)
+			return;
+		sizeT perLine = _alignment / sizeof(T) > 0 ? _alignment / sizeof(T) : 1;
+		sizeT capacity = (n + perLine - 1) / perLine * perLine;
+		T *re = allocate(capacity), *im = allocate(capacity);
+		if (_size > 0) {
+			memcpy(re, _re, _size * sizeof(T));
+			memcpy(im, _im, _size * sizeof(T));
+		}
+		sizeT size = _size;
+		release();
+		_re = re;
+		_im = im;
+		_size = size;
+		_capacity = capacity;
+	}
+
+	void checkSize(const ComplexArray &other) const {
+		if (other._size != _size)
+			throw std::length_error("ComplexArray sizes don't match.");
+	}
+
+	template<typename K>
+	static void binary(const ComplexArray &a, const ComplexArray &b, ComplexArray &out) {
+		if constexpr (_lanes) {
+			ComplexLanes::runAll<ComplexLanes::Binary<K>, T>(a._re, a._im, b._re, b._im, out._re, out._im,
+			                                                 (size_t) a._size);
+		} else {
+			for (sizeT i = 0; i < a._size; i++)
+				K::template block<T>(a._re + i, a._im + i, b._re + i, b._im + i, out._re + i, out._im + i);
+		}
+	}
+
+	template<bool Conjugate>
+	Complex<T> product(const ComplexArray &other) const {
+		checkSize(other);
+		T re = 0, im = 0;
+		if constexpr (_lanes) {
+			ComplexLanes::runAll<ComplexLanes::DotKernel<Conjugate>, T>((const T *) _re, (const T *) _im,
+			                                                           (const T *) other._re, (const T *) other._im,
+			                                                           &re, &im, (size_t) _size);
+		} else {
+			for (sizeT i = 0; i < _size; i++) {
+				re += Conjugate ? _re[i] * other._re[i] + _im[i] * other._im[i]
+				                : _re[i] * other._re[i] - _im[i] * other._im[i];
+				im += Conjugate ? _re[i] * other._im[i] - _im[i] * other._re[i]
+				                : _re[i] * other._im[i] + _im[i] * other._re[i];
+			}
+		}
+		return Complex<T>(re, im);
+	}
+
+public:
+	const sizeT *size = &_size;
+
+	explicit ComplexArray(sizeT t_size = 0) {
+		resize(t_size);
+	}
+
+	ComplexArray(const Vector<Complex<T>> &values) {
+		reserve(*values.size);
+		_size = *values.size;
+		for (sizeT i = 0; i < _size; i++) {
+			Complex<T> value = values[i];
+			_re[i] = value.real();
+			_im[i] = value.imag();
+		}
+	}
+
+	ComplexArray(const ComplexArray &other) {
+		reserve(other._size);
+		_size = other._size;
+		memcpy(_re, other._re, _size * sizeof(T));
+		memcpy(_im, other._im, _size * sizeof(T));
+	}
+
+	ComplexArray(ComplexArray &&other) noexcept
+		: _re(other._re), _im(other._im), _size(other._size), _capacity(other._capacity) {
+		other._re = other._im = nullptr;
+		other._size = other._capacity = 0;
+	}
+
+	~ComplexArray() {
+		release();
+	}
+
+	ComplexArray &operator=(const ComplexArray &other) {
+		if (this != &other) {
+			_size = 0;
+			reserve(other._size);
+			_size = other._size;
+			memcpy(_re, other._re, _size * sizeof(T));
+			memcpy(_im, other._im, _size * sizeof(T));
+		}
+		return *this;
+	}
+
+	ComplexArray &operator=(ComplexArray &&other) noexcept {
+		if (this != &other) {
+			release();
+			_re = other._re;
+			_im = other._im;
+			_size = other._size;
+			_capacity = other._capacity;
+			other._re = other._im = nullptr;
+			other._size = other._capacity = 0;
+		}
+		return *this;
+	}
+
+	// new elements are zero
+	void resize(sizeT t_size) {
+		reserve(t_size);
+		if (t_size > _size) {
+			memset(_re + _size, 0, (t_size - _size) * sizeof(T));
+			memset(_im + _size, 0, (t_size - _size) * sizeof(T));
+		}
+		_size = t_size;
+	}
+
+	Vector<Complex<T>> toVector() const {
+		Vector<Complex<T>> result(_size);
+		for (sizeT i = 0; i < _size; i++)
+			result[i] = Complex<T>(_re[i], _im[i]);
+		return result;
+	}
+
+	Complex<T> operator[](sizeT index) const {
+		if (index >= _size) throw std::runtime_error("Accessing element at invalid location in ComplexArray.");
+		return Complex<T>(_re[index], _im[index]);
+	}
+
+	void set(sizeT index, Complex<T> value) {
+		if (index >= _size) throw std::runtime_error("Accessing element at invalid location in ComplexArray.");
+		_re[index] = value.real();
+		_im[index] = value.imag();
+	}
+
+	// the parts themselves, 64-byte aligned
+	T *real() const {
+		return _re;
+	}
+
+	T *imag() const {
+		return _im;
+	}
+
+	ComplexArray &operator+=(const ComplexArray &other) {
+		checkSize(other);
+		binary<ComplexLanes::AddKernel<false>>(*this, other, *this);
+		return *this;
+	}
+
+	ComplexArray &operator-=(const ComplexArray &other) {
+		checkSize(other);
+		binary<ComplexLanes::AddKernel<true>>(*this, other, *this);
+		return *this;
+	}
+
+	// element-wise product
+	ComplexArray &operator*=(const ComplexArray &other) {
+		checkSize(other);
+		binary<ComplexLanes::MultiplyKernel>(*this, other, *this);
+		return *this;
+	}
+
+	ComplexArray operator+(const ComplexArray &other) const {
+		checkSize(other);
+		ComplexArray result(_size);
+		binary<ComplexLanes::AddKernel<false>>(*this, other, result);
+		return result;
+	}
+
+	ComplexArray operator-(const ComplexArray &other) const {
+		checkSize(other);
+		ComplexArray result(_size);
+		binary<ComplexLanes::AddKernel<true>>(*this, other, result);
+		return result;
+	}
+
+	ComplexArray operator*(const ComplexArray &other) const {
+		checkSize(other);
+		ComplexArray result(_size);
+		binary<ComplexLanes::MultiplyKernel>(*this, other, result);
+		return result;
+	}
+
+	// this += a * b element by element, with fused multiply-adds where there are any
+	ComplexArray &addmul(const ComplexArray &a, const ComplexArray &b) {
+		checkSize(a);
+		checkSize(b);
+		binary<ComplexLanes::MultiplyAddKernel>(a, b, *this);
+		return *this;
+	}
+
+	// conjugates every element in place
+	ComplexArray &conjugate() {
+		if constexpr (_lanes)
+			ComplexLanes::runAll<ComplexLanes::NegateKernel, T>((const T *) _im, _im, (size_t) _size);
+		else
+			for (sizeT i = 0; i < _size; i++)
+				_im[i] = -_im[i];
+		return *this;
+	}
+
+	ComplexArray conj() const {
+		ComplexArray result(*this);
+		result.conjugate();
+		return result;
+	}
+
+	void magnitude(T *out) const {
+		if constexpr (_lanes)
+			ComplexLanes::runAll<ComplexLanes::MagnitudeKernel, T>((const T *) _re, (const T *) _im, out,
+			                                                      (size_t) _size);
+		else
+			for (sizeT i = 0; i < _size; i++)
+				out[i] = std::hypot(_re[i], _im[i]);
+	}
+
+	Vector<T> magnitude() const {
+		Vector<T> result(_size);
+		magnitude(result.data());
+		return result;
+	}
+
+	// sum of this[i] * other[i]
+	Complex<T> dot(const ComplexArray &other) const {
+		return product<false>(other);
+	}
+
+	// sum of conj(this[i]) * other[i], the inner product
+	Complex<T> conjDot(const ComplexArray &other) const {
+		return product<true>(other);
+	}
+};
+
+#endif //COMPLEX_ARRAY_HPP
@@ -0,0 +1,291 @@
+// Artem Mikheev 2020
+// GNU GPLv3 License
+
+#include "complex.hpp"
+#include "fft.hpp"
+#include "math.hpp"
+#include "ntt.hpp"
+#include "thread_pool.hpp"
+#include "vector.hpp"
+#include "vartypes.hpp"
+#include <cstring>
+#include <stdexcept>
+
+#ifndef CONVOLUTION_HPP
+#define CONVOLUTION_HPP
+
+// Linear convolution out[k] = sum of a[i] * b[k - i] of an and bn values into an + bn - 1
+// values, which is also the product of the polynomials with those coefficients. out must
+// not overlap the inputs. Doubles go through a real FFT of a power of two of at least
+// an + bn - 1 points, or through blocks of overlap-add when one input is much longer than
+// the other; integers modulo m through number theoretic transforms modulo as many of the
+// word-size primes of ntt.hpp as the exact sums need. Short inputs are multiplied out
+
+namespace Convolution {
+	// shorter inputs than these are convolved directly, measured with the longer one at
+	// 2^10 and 2^16 values on x86-64
+	const sizeT directThreshold = 96;
+	const sizeT directModThreshold = 256;
+	// longer inputs at least this many times longer than the shorter one go through overlap-add
+	const sizeT overlapRatio = 4;
+
+	void direct(const double *a, sizeT an, const double *b, sizeT bn, double *out) {
+		// Convolve by the definition, the longer input in the inner loop
+		if (an < bn) {
+			Algorithm::swap(a, b);
+			Algorithm::swap(an, bn);
+		}
+		memset(out, 0, (an + bn - 1) * sizeof(double));
+		for (sizeT i = 0; i < bn; i++) {
+			double x = b[i];
+			double *y = out + i;
+			for (sizeT j = 0; j < an; j++)
+				y[j] += x * a[j];
+		}
+	}
+
+	// Convolution of a signal given in pieces with a fixed kernel, one block of
+	// *block inputs at a time: every block is convolved on its own and the last
+	// kernelSize - 1 values of each result are added to the start of the next one.
+	// Memory stays proportional to the kernel whatever the length of the signal
+	class OverlapAdd {
+		sizeT _kernelSize;
+		sizeT _block;
+		sizeT _filled = 0;
+		Vector<double> _kernel;
+		// transform of the kernel padded to the plan size, empty for short kernels
+		const RealFFTPlan<double> *_plan = nullptr;
+		Vector<Complex<double>> _spectrum;
+		Vector<Complex<double>> _work;
+		Vector<double> _pending;
+		Vector<double> _tail;
+
+		// convolves t_count <= _block inputs, writes the t_count values that are now final
+		// and keeps the following kernelSize - 1 for the next block
+		void process(const double *x, sizeT t_count, double *out) {
+			sizeT overlap = _kernelSize - 1;
+			double *y = reinterpret_cast<double *>(_work.data());
+			if (_plan == nullptr) {
+				direct(x, t_count, _kernel.data(), _kernelSize, y);
+			} else {
+				sizeT points = *_plan->size;
+				memcpy(y, x, t_count * sizeof(double));
+				memset(y + t_count, 0, (points - t_count) * sizeof(double));
+				_plan->forward(y, _work.data());
+				Complex<double> *z = _work.data(), *h = _spectrum.data();
+				for (sizeT k = 0; k <= points / 2; k++)
+					z[k] = z[k] * h[k];
+				_plan->inverse(_work.data(), y);
+			}
+			const double *tail = _tail.data();
+			for (sizeT k = 0; k < overlap; k++)
+				y[k] += tail[k];
+			memcpy(out, y, t_count * sizeof(double));
+			memcpy(_tail.data(), y + t_count, overlap * sizeof(double));
+		}
+
+	public:
+		const sizeT *block = &_block;
+
+		// Blocks are made as long as fits in a transform of a power of two of at least
+		// t_minBlock + t_kernelSize - 1 points, four times the kernel by default
+		OverlapAdd(const double *t_kernel, sizeT t_kernelSize, sizeT t_minBlock = 0)
+				: _kernelSize(t_kernelSize),
+				  _kernel(t_kernelSize),
+				  _tail(t_kernelSize) {
+			if (t_kernelSize == 0)
+				throw std::logic_error("Convolution kernel can't be empty.");
+			memcpy(_kernel.data(), t_kernel, t_kernelSize * sizeof(double));
+			if (t_minBlock == 0)
+				t_minBlock = 3 * t_kernelSize;
+			if (t_kernelSize < directThreshold) {
+				_block = t_minBlock < 4096 ? 4096 : t_minBlock;
+				_work.resize(_block / 2 + t_kernelSize);
+			} else {
+				sizeT points = Math::roundToNextPowerOfTwo(t_minBlock + t_kernelSize - 1);
+				_block = points - t_kernelSize + 1;
+				_plan = &RealFFTPlan<double>::cached(points);
+				_spectrum.resize(points / 2 + 1);
+				double *h = reinterpret_cast<double *>(_spectrum.data());
+				memcpy(h, t_kernel, t_kernelSize * sizeof(double));
+				memset(h + t_kernelSize, 0, (points - t_kernelSize) * sizeof(double));
+				_plan->forward(h, _spectrum.data());
+				_work.resize(points / 2 + 1);
+			}
+			_pending.resize(_block);
+		}
+
+		// block points at this object's own block length
+		OverlapAdd(const OverlapAdd &other) = delete;
+
+		OverlapAdd &operator=(const OverlapAdd &other) = delete;
+
+		// Takes the next t_count inputs and writes the outputs that are final, a whole
+		// number of blocks, to out, which must hold t_count + *block - 1 values
+		sizeT push(const double *in, sizeT t_count, double *out) {
+			sizeT written = 0;
+			while (t_count > 0) {
+				// whole blocks are convolved where they are
+				if (_filled == 0 && t_count >= _block) {
+					process(in, _block, out + written);
+					in += _block;
+					t_count -= _block;
+					written += _block;
+					continue;
+				}
+				sizeT take = Algorithm::min(t_count, _block - _filled);
+				memcpy(_pending.data() + _filled, in, take * sizeof(double));
+				_filled += take;
+				in += take;
+				t_count -= take;
+				if (_filled == _block) {
+					process(_pending.data(), _block, out + written);
+					_filled = 0;
+					written += _block;
+				}
+			}
+			return written;
+		}
+
+		// Ends the signal: writes the remaining outputs, fewer than *block + kernelSize,
+		// and returns their number. Pushing afterwards starts a new signal
+		sizeT finish(double *out) {
+			sizeT overlap = _kernelSize - 1, written = _filled + overlap;
+			if (_filled > 0)
+				process(_pending.data(), _filled, out);
+			memcpy(out + _filled, _tail.data(), overlap * sizeof(double));
+			memset(_tail.data(), 0, overlap * sizeof(double));
+			_filled = 0;
+			return written;
+		}
+	};
+
+	void convolve(const double *a, sizeT an, const double *b, sizeT bn, double *out) {
+		// Convolve through the real FFT, with overlap-add for very unequal lengths
+		if (an == 0 || bn == 0)
+			return;
+		if (an < bn) {
+			Algorithm::swap(a, b);
+			Algorithm::swap(an, bn);
+		}
+		if (bn < directThreshold)
+			return direct(a, an, b, bn, out);
+		if (an / bn >= overlapRatio) {
+			OverlapAdd filter(b, bn);
+			sizeT written = filter.push(a, an, out);
+			filter.finish(out + written);
+			return;
+		}
+		sizeT points = Math::roundToNextPowerOfTwo(an + bn - 1);
+		const RealFFTPlan<double> &plan = RealFFTPlan<double>::cached(points);
+		Vector<Complex<double>> fa(points / 2 + 1), fb(points / 2 + 1);
+		double *x = reinterpret_cast<double *>(fa.data()), *y = reinterpret_cast<double *>(fb.data());
+		memcpy(x, a, an * sizeof(double));
+		memset(x + an, 0, (points - an) * sizeof(double));
+		memcpy(y, b, bn * sizeof(double));
+		memset(y + bn, 0, (points - bn) * sizeof(double));
+		plan.forward(x, fa.data());
+		plan.forward(y, fb.data());
+		Complex<double> *z = fa.data(), *h = fb.data();
+		for (sizeT k = 0; k <= points / 2; k++)
+			z[k] = z[k] * h[k];
+		plan.inverse(fa.data(), x);
+		memcpy(out, x, (an + bn - 1) * sizeof(double));
+	}
+
+	void convolve(const uint64 *a, sizeT an, const uint64 *b, sizeT bn, uint64 *out, uint64 t_mod,
+	              ThreadPool *pool = nullptr) {
+		// Convolve modulo t_mod exactly: the sums are found modulo primes whose product
+		// exceeds them and put together by Garner's CRT. Transforms of different primes
+		// and the stages of each one run on the pool when there is one
+		typedef Limbs::wide wide;
+		if (t_mod == 0)
+			throw std::logic_error("Can't take remainder modulo 0.");
+		if (an == 0 || bn == 0)
+			return;
+		sizeT len = an + bn - 1;
+		if (an < bn) {
+			Algorithm::swap(a, b);
+			Algorithm::swap(an, bn);
+		}
+		// inputs of at least t_mod are reduced first, to keep the sums in range
+		Vector<uint64> reduced;
+		auto reduce = [&](const uint64 *&x, sizeT n, sizeT offset) {
+			for (sizeT i = 0; i < n; i++)
+				if (x[i] >= t_mod) {
+					if (*reduced.size == 0)
+						reduced.resize(an + bn);
+					uint64 *copy = reduced.data() + offset;
+					for (sizeT j = 0; j < n; j++)
+						copy[j] = x[j] % t_mod;
+					x = copy;
+					return;
+				}
+		};
+		reduce(a, an, 0);
+		reduce(b, bn, an);
+
+		if (bn < directModThreshold) {
+			// products are summed in 128 bits, 2^128 mod t_mod stands in for a wrap around
+			wide wrap = ((wide) -1 % t_mod + 1) % t_mod;
+			for (sizeT k = 0; k < len; k++) {
+				sizeT from = k >= an ? k - an + 1 : 0, to = Algorithm::min(k, bn - 1);
+				wide sum = 0;
+				for (sizeT j = from; j <= to; j++) {
+					wide product = (wide) b[j] * a[k - j];
+					sum += product;
+					if (sum < product)
+						sum += wrap;
+				}
+				out[k] = (uint64) (sum % t_mod);
+			}
+			return;
+		}
+
+		// every sum is below bn * t_mod^2
+		wide square = (wide) (t_mod - 1) * (t_mod - 1);
+		const Limbs::NttPrime &m0 = Limbs::nttPrime(0), &m1 = Limbs::nttPrime(1), &m2 = Limbs::nttPrime(2);
+		wide p01 = (wide) m0.p * m1.p;
+		ubyte primes = square <= (m0.p - 1) / bn ? 1 : (square <= (p01 - 1) / bn ? 2 : 3);
+		sizeT n = Math::roundToNextPowerOfTwo(len);
+		sizeT copies = pool != nullptr ? primes : 1;
+		Vector<uint64> residues(primes * n), other(copies * n), roots(copies * n), rootsShoup(copies * n);
+		auto transform = [&](sizeT k) {
+			sizeT buffer = copies > 1 ? k * n : 0;
+			Limbs::nttConvolve(residues.data() + k * n, a, an, b, bn, n, len, other.data() + buffer,
+			                   roots.data() + buffer, rootsShoup.data() + buffer, Limbs::nttPrime(k), pool);
+		};
+		if (pool != nullptr) {
+			pool->parallelFor(primes, transform);
+		} else {
+			for (ubyte k = 0; k < primes; k++)
+				transform(k);
+		}
+
+		// the sum is v0 + v1 * p0 + v2 * p0 * p1 with v0 < p0, v1 < p1 and v2 < p2
+		const uint64 *x0 = residues.data(), *x1 = x0 + (primes > 1 ? n : 0), *x2 = x0 + (primes > 2 ? 2 * n : 0);
+		uint64 inv01 = m1.pow(m1.toMont(m0.p), m1.p - 2);
+		uint64 inv012 = m2.pow(m2.mul(m2.toMont(m0.p), m2.toMont(m1.p)), m2.p - 2);
+		uint64 p0Mod2 = m2.toMont(m0.p), p01Mod = (uint64) (p01 % t_mod);
+		for (sizeT i = 0; i < len; i++) {
+			uint64 v0 = x0[i];
+			if (primes == 1) {
+				out[i] = v0 % t_mod;
+				continue;
+			}
+			uint64 v1 = m1.mul(m1.sub(x1[i], v0 >= m1.p ? v0 - m1.p : v0), inv01);
+			wide low = (wide) v1 * m0.p + v0;
+			if (primes == 2) {
+				out[i] = (uint64) (low % t_mod);
+				continue;
+			}
+			uint64 v0Mod2 = v0 >= m2.p ? v0 - m2.p : v0;
+			v0Mod2 = v0Mod2 >= m2.p ? v0Mod2 - m2.p : v0Mod2;
+			uint64 v2 = m2.sub(m2.sub(x2[i], v0Mod2), m2.mul(v1 >= m2.p ? v1 - m2.p : v1, p0Mod2));
+			v2 = m2.mul(v2, inv012);
+			out[i] = (uint64) ((low % t_mod + (wide) v2 * p01Mod) % t_mod);
+		}
+	}
+}
+
+#endif //CONVOLUTION_HPP
@@ -0,0 +1,393 @@
+// Artem Mikheev 2020
+// GNU GPLv3 License
+
+#include "complex.hpp"
+#include "vector.hpp"
+#include "vartypes.hpp"
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+#ifndef FFT_HPP
+#define FFT_HPP
+
+// Discrete Fourier transforms of Complex<T> arrays through precomputed plans.
+// forward multiplies by e^(-2 pi i jk / n) and inverse by e^(2 pi i jk / n) / n, so
+// inverse undoes forward. Powers of two are transformed in place: a bit reversal,
+// one radix-8, radix-4 or radix-2 pass with constant twiddles and then radix-4 passes,
+// each reading its twiddles in order from its own table.
+// Other sizes go through Bluestein's chirp z-transform on a power of two of at least 2n - 1.
+// The kernels read Complex<T> arrays as pairs of T, which is all the class holds
+
+// Plans built once per size and deleted at exit, behind cached() of the plan classes
+template<typename Plan>
+class FFTPlanCache {
+	std::mutex _mutex;
+	Vector<Plan *> _plans;
+
+public:
+	FFTPlanCache() {}
+
+	FFTPlanCache(const FFTPlanCache &other) = delete;
+
+	FFTPlanCache &operator=(const FFTPlanCache &other) = delete;
+
+	~FFTPlanCache() {
+		for (sizeT i = 0; i < *_plans.size; i++)
+			delete _plans[i];
+	}
+
+	const Plan &get(sizeT t_size) {
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (sizeT i = 0; i < *_plans.size; i++)
+			if (*_plans[i]->size == t_size)
+				return *_plans[i];
+		_plans.push(new Plan(t_size));
+		return *_plans.back();
+	}
+};
+
+template<typename T>
+class FFTPlan {
+	static_assert(sizeof(Complex<T>) == 2 * sizeof(T), "Complex<T> has to be two adjacent T");
+
+	// 2^16 points of double are 1 MiB, which is about L2
+	static const sizeT blockPoints = 1 << 16;
+
+	sizeT _size;
+	// points of the blocks made by the pass with constant twiddles
+	sizeT _first = 0;
+	// re and im of e^(-2 pi i j / 4m) for j < m, for every radix-4 pass on blocks of
+	// 4m points in turn. The table of the pass of m starts at (m - _first) / 3
+	Vector<T> _twiddles;
+	// Bluestein: the transform of the power of two size, the chirp e^(-pi i k^2 / n) for k < n
+	// and the transform of its conjugate, already divided by the inner size
+	FFTPlan *_inner = nullptr;
+	Vector<T> _chirp;
+	Vector<T> _kernel;
+
+	void bitReverse(T *x) const {
+		for (sizeT i = 1, j = 0; i < _size; i++) {
+			sizeT bit = _size >> 1;
+			for (; j & bit; bit >>= 1)
+				j ^= bit;
+			j ^= bit;
+			if (i < j) {
+				T re = x[2 * i], im = x[2 * i + 1];
+				x[2 * i] = x[2 * j];
+				x[2 * i + 1] = x[2 * j + 1];
+				x[2 * j] = re;
+				x[2 * j + 1] = im;
+			}
+		}
+	}
+
+	// blocks of 2 points
+	void pass2(T *x, sizeT t_points) const {
+		for (sizeT s = 0; s < 2 * t_points; s += 4) {
+			T r = x[s + 2], i = x[s + 3];
+			x[s + 2] = x[s] - r;
+			x[s + 3] = x[s + 1] - i;
+			x[s] += r;
+			x[s + 1] += i;
+		}
+	}
+
+	// One radix-4 butterfly over the points at p, p + m, p + 2m and p + 3m, the last three
+	// multiplied by w^2, w and w^3 first. It merges the two radix-2 steps of lengths 2m and 4m
+	template<bool Inverse>
+	static inline void butterfly4(T *p, sizeT m, T wr, T wi) {
+		T w2r = wr * wr - wi * wi, w2i = 2 * wr * wi;
+		T w3r = w2r * wr - w2i * wi, w3i = w2r * wi + w2i * wr;
+		T *p1 = p + 2 * m, *p2 = p + 4 * m, *p3 = p + 6 * m;
+		T t1r = p1[0] * w2r - p1[1] * w2i, t1i = p1[0] * w2i + p1[1] * w2r;
+		T t2r = p2[0] * wr - p2[1] * wi, t2i = p2[0] * wi + p2[1] * wr;
+		T t3r = p3[0] * w3r - p3[1] * w3i, t3i = p3[0] * w3i + p3[1] * w3r;
+		T a0r = p[0] + t1r, a0i = p[1] + t1i, a1r = p[0] - t1r, a1i = p[1] - t1i;
+		T br = t2r + t3r, bi = t2i + t3i, dr = t2r - t3r, di = t2i - t3i;
+		// y1 = a1 - i d going forward and a1 + i d going back
+		if (Inverse) {
+			dr = -dr;
+			di = -di;
+		}
+		p[0] = a0r + br;
+		p[1] = a0i + bi;
+		p2[0] = a0r - br;
+		p2[1] = a0i - bi;
+		p1[0] = a1r + di;
+		p1[1] = a1i - dr;
+		p3[0] = a1r - di;
+		p3[1] = a1i + dr;
+	}
+
+	// blocks of 4 points, all twiddles are 1
+	template<bool Inverse>
+	void pass4(T *x, sizeT t_points) const {
+		for (sizeT s = 0; s < 2 * t_points; s += 8)
+			butterfly4<Inverse>(x + s, 1, 1, 0);
+	}
+
+	// blocks of 8 points: pairs, then the radix-4 step of length 8 with the twiddles
+	// 1 and e^(-+pi i / 4)
+	template<bool Inverse>
+	void pass8(T *x, sizeT t_points) const {
+		const T half = std::sqrt((T) 0.5);
+		for (sizeT s = 0; s < 2 * t_points; s += 16) {
+			T *p = x + s;
+			for (sizeT k = 0; k < 16; k += 4) {
+				T r = p[k + 2], i = p[k + 3];
+				p[k + 2] = p[k] - r;
+				p[k + 3] = p[k + 1] - i;
+				p[k] += r;
+				p[k + 1] += i;
+			}
+			butterfly4<Inverse>(p, 2, 1, 0);
+			butterfly4<Inverse>(p + 2, 2, half, Inverse ? half : -half);
+		}
+	}
+
+	// blocks of 4m points out of four transforms of length m each
+	template<bool Inverse>
+	void pass(T *x, sizeT t_points, sizeT m) const {
+		const T *w = _twiddles.data() + 2 * ((m - _first) / 3);
+		for (sizeT s = 0; s < 2 * t_points; s += 8 * m)
+			for (sizeT j = 0; j < m; j++)
+				butterfly4<Inverse>(x + s + 2 * j, m, w[2 * j], Inverse ? -w[2 * j + 1] : w[2 * j + 1]);
+	}
+
+	// power of two transform without the division by n. The passes that stay within
+	// blockPoints are all run on one block before the next one, so that only the last
+	// few passes of large transforms stream the whole array through the cache
+	template<bool Inverse>
+	void radix(T *x) const {
+		if (_size == 1)
+			return;
+		bitReverse(x);
+		sizeT block = _size < blockPoints ? _size : blockPoints, m = _first;
+		for (sizeT s = 0; s < _size; s += block) {
+			T *y = x + 2 * s;
+			if (_first == 2)
+				pass2(y, block);
+			else if (_first == 8)
+				pass8<Inverse>(y, block);
+			else
+				pass4<Inverse>(y, block);
+			for (m = _first; 4 * m <= block; m *= 4)
+				pass<Inverse>(y, block, m);
+		}
+		for (; m < _size; m *= 4)
+			pass<Inverse>(x, _size, m);
+	}
+
+	// Bluestein's transform without the division by n. The inverse one is the conjugate
+	// of the forward one of the conjugate
+	template<bool Inverse>
+	void bluestein(T *x) const {
+		sizeT inner = *_inner->size;
+		Vector<T> buffer(2 * inner);
+		T *a = buffer.data();
+		const T *chirp = _chirp.data(), *kernel = _kernel.data();
+		for (sizeT k = 0; k < _size; k++) {
+			T re = x[2 * k], im = Inverse ? -x[2 * k + 1] : x[2 * k + 1];
+			a[2 * k] = re * chirp[2 * k] - im * chirp[2 * k + 1];
+			a[2 * k + 1] = re * chirp[2 * k + 1] + im * chirp[2 * k];
+		}
+		_inner->radix<false>(a);
+		for (sizeT k = 0; k < inner; k++) {
+			T re = a[2 * k], im = a[2 * k + 1];
+			a[2 * k] = re * kernel[2 * k] - im * kernel[2 * k + 1];
+			a[2 * k + 1] = re * kernel[2 * k + 1] + im * kernel[2 * k];
+		}
+		_inner->radix<true>(a);
+		for (sizeT k = 0; k < _size; k++) {
+			T re = a[2 * k], im = a[2 * k + 1];
+			x[2 * k] = re * chirp[2 * k] - im * chirp[2 * k + 1];
+			x[2 * k + 1] = re * chirp[2 * k + 1] + im * chirp[2 * k];
+			if (Inverse)
+				x[2 * k + 1] = -x[2 * k + 1];
+		}
+	}
+
+	template<bool Inverse>
+	void run(T *x) const {
+		if (_inner == nullptr)
+			radix<Inverse>(x);
+		else
+			bluestein<Inverse>(x);
+	}
+
+public:
+	const sizeT *size = &_size;
+
+	explicit FFTPlan(sizeT t_size)
+			: _size(t_size) {
+		if (t_size == 0)
+			throw std::logic_error("FFT size has to be positive.");
+		// 2n has to fit in sizeT, and so does twice Bluestein's inner size of up to 4n
+		if ((t_size & (t_size - 1)) == 0) {
+			if (t_size > (1U << 30))
+				throw std::length_error("FFT size is too large.");
+			sizeT log = 0;
+			while ((1U << log) < t_size)
+				log++;
+			_first = log == 1 ? 2 : (log % 2 ? 8 : 4);
+			if (t_size <= _first)
+				return;
+			// the last pass has all the others' twiddles among its own
+			sizeT last = t_size / 4;
+			_twiddles.resize(2 * ((4 * last - _first) / 3));
+			T *w = _twiddles.data() + 2 * ((last - _first) / 3);
+			for (sizeT j = 0; j < last; j++) {
+				long double angle = -2 * Math::pi * j / t_size;
+				w[2 * j] = std::cos(angle);
+				w[2 * j + 1] = std::sin(angle);
+			}
+			for (sizeT m = _first; m < last; m *= 4) {
+				T *stage = _twiddles.data() + 2 * ((m - _first) / 3);
+				for (sizeT j = 0; j < m; j++) {
+					stage[2 * j] = w[2 * j * (last / m)];
+					stage[2 * j + 1] = w[2 * j * (last / m) + 1];
+				}
+			}
+			return;
+		}
+		if (t_size > (1U << 29))
+			throw std::length_error("FFT size is too large for Bluestein's transform.");
+		sizeT inner = 1;
+		while (inner < 2 * t_size - 1)
+			inner *= 2;
+		_inner = new FFTPlan(inner);
+		_chirp.resize(2 * t_size);
+		_kernel.resize(2 * inner);
+		for (sizeT k = 0; k < t_size; k++) {
+			// k^2 mod 2n keeps the angle small and exact
+			long double angle = -Math::pi * (long double) ((unsigned long long) k * k % (2ULL * t_size)) / t_size;
+			_chirp[2 * k] = std::cos(angle);
+			_chirp[2 * k + 1] = std::sin(angle);
+		}
+		T *kernel = _kernel.data();
+		for (sizeT k = 0; k < t_size; k++) {
+			kernel[2 * k] = _chirp[2 * k] / inner;
+			kernel[2 * k + 1] = -_chirp[2 * k + 1] / inner;
+			if (k > 0) {
+				kernel[2 * (inner - k)] = kernel[2 * k];
+				kernel[2 * (inner - k) + 1] = kernel[2 * k + 1];
+			}
+		}
+		_inner->radix<false>(kernel);
+	}
+
+	FFTPlan(const FFTPlan &other) = delete;
+
+	FFTPlan &operator=(const FFTPlan &other) = delete;
+
+	~FFTPlan() {
+		delete _inner;
+	}
+
+	void forward(Complex<T> *t_data) const {
+		run<false>(reinterpret_cast<T *>(t_data));
+	}
+
+	void inverse(Complex<T> *t_data) const {
+		T *x = reinterpret_cast<T *>(t_data);
+		run<true>(x);
+		T scale = (T) 1 / _size;
+		for (sizeT i = 0; i < 2 * _size; i++)
+			x[i] *= scale;
+	}
+
+	// Plan of the given size shared by all callers, built on first use and kept until exit
+	static const FFTPlan &cached(sizeT t_size) {
+		static FFTPlanCache<FFTPlan> cache;
+		return cache.get(t_size);
+	}
+};
+
+// Transform of n real numbers, n even, through a complex one of n/2 points: the pairs
+// x[2k] + i x[2k+1] are transformed together and split into the transforms of the even
+// and odd halves afterwards. forward writes the n/2 + 1 outputs X[0..n/2], the rest
+// being their conjugates, and inverse takes them back to n real numbers
+template<typename T>
+class RealFFTPlan {
+	sizeT _size;
+	FFTPlan<T> _half;
+	// re and im of e^(-2 pi i k / n) for k <= n/4
+	Vector<T> _twiddles;
+
+public:
+	const sizeT *size = &_size;
+
+	explicit RealFFTPlan(sizeT t_size)
+			: _size(t_size),
+			  _half(t_size == 0 || t_size % 2 ? throw std::logic_error("Real FFT size has to be even and positive.")
+			                                  : t_size / 2) {
+		_twiddles.resize(2 * (t_size / 4 + 1));
+		for (sizeT k = 0; k <= t_size / 4; k++) {
+			long double angle = -2 * Math::pi * k / t_size;
+			_twiddles[2 * k] = std::cos(angle);
+			_twiddles[2 * k + 1] = std::sin(angle);
+		}
+	}
+
+	RealFFTPlan(const RealFFTPlan &other) = delete;
+
+	RealFFTPlan &operator=(const RealFFTPlan &other) = delete;
+
+	void forward(const T *t_in, Complex<T> *out) const {
+		sizeT h = _size / 2;
+		T *z = reinterpret_cast<T *>(out);
+		memmove(z, t_in, _size * sizeof(T));
+		_half.forward(out);
+		const T *w = _twiddles.data();
+		T re = z[0], im = z[1];
+		z[0] = re + im;
+		z[1] = 0;
+		z[2 * h] = re - im;
+		z[2 * h + 1] = 0;
+		// X[k] = E + W^k O and X[h-k] = conj(E - W^k O) with E = (Z[k] + conj Z[h-k]) / 2
+		// and O = (Z[k] - conj Z[h-k]) / 2i
+		for (sizeT k = 1; k <= h / 2; k++) {
+			T *p = z + 2 * k, *q = z + 2 * (h - k);
+			T er = (p[0] + q[0]) / 2, ei = (p[1] - q[1]) / 2;
+			T or_ = (p[1] + q[1]) / 2, oi = (q[0] - p[0]) / 2;
+			T tr = w[2 * k] * or_ - w[2 * k + 1] * oi, ti = w[2 * k] * oi + w[2 * k + 1] * or_;
+			p[0] = er + tr;
+			p[1] = ei + ti;
+			q[0] = er - tr;
+			q[1] = ti - ei;
+		}
+	}
+
+	void inverse(const Complex<T> *t_in, T *out) const {
+		sizeT h = _size / 2;
+		const T *x = reinterpret_cast<const T *>(t_in);
+		const T *w = _twiddles.data();
+		// Z[k] = E + i O and Z[h-k] = conj E + i conj O with E = (X[k] + conj X[h-k]) / 2
+		// and O = (X[k] - conj X[h-k]) conj(W^k) / 2
+		T x0 = x[0], xh = x[2 * h];
+		for (sizeT k = 1; k <= h / 2; k++) {
+			const T *p = x + 2 * k, *q = x + 2 * (h - k);
+			T er = (p[0] + q[0]) / 2, ei = (p[1] - q[1]) / 2;
+			T dr = (p[0] - q[0]) / 2, di = (p[1] + q[1]) / 2;
+			T or_ = dr * w[2 * k] + di * w[2 * k + 1], oi = di * w[2 * k] - dr * w[2 * k + 1];
+			T zr = er - oi, zi = ei + or_, yr = er + oi, yi = or_ - ei;
+			out[2 * k] = zr;
+			out[2 * k + 1] = zi;
+			out[2 * (h - k)] = yr;
+			out[2 * (h - k) + 1] = yi;
+		}
+		out[0] = (x0 + xh) / 2;
+		out[1] = (x0 - xh) / 2;
+		_half.inverse(reinterpret_cast<Complex<T> *>(out));
+	}
+
+	// Plan of the given size shared by all callers, built on first use and kept until exit
+	static const RealFFTPlan &cached(sizeT t_size) {
+		static FFTPlanCache<RealFFTPlan> cache;
+		return cache.get(t_size);
+	}
+};
+
+#endif //FFT_HPP
@@ -0,0 +1,521 @@
+// Artem Mikheev 2020
+// GNU GPLv3 License
+
+#include "big.hpp"
+
+#ifndef FIXED_BIG_HPP
+#define FIXED_BIG_HPP
+
+// Fixed-width integers of Bits bits, a multiple of 64, for hashes, fixed-point accumulators
+// and other arithmetic where the size is known up front. The limbs live inside the object,
+// every loop runs a compile-time number of times and is unrolled, and everything except
+// the conversions to and from BigInt is constexpr.
+// Arithmetic wraps around modulo 2^Bits like the built-in unsigned types
+
+template<sizeT Bits>
+class BigUInt {
+	static_assert(Bits > 0 && Bits % 64 == 0, "BigUInt width must be a multiple of 64 bits.");
+	typedef unsigned __int128 wide;
+
+public:
+	static constexpr sizeT limbCount = Bits / 64;
+
+private:
+	uint64 _limbs[limbCount] = {};
+
+	// number of limbs up to the highest nonzero one
+	constexpr sizeT used() const {
+		sizeT n = limbCount;
+		while (n > 0 && _limbs[n - 1] == 0)
+			n--;
+		return n;
+	}
+
+	// Knuth's algorithm D on the used limbs, q or r may be nullptr
+	static constexpr void divide(const BigUInt &a, const BigUInt &b, BigUInt *q, BigUInt *r) {
+		sizeT m = a.used(), n = b.used();
+		if (n == 0)
+			throw std::runtime_error("Can't divide BigUInt by zero.");
+		BigUInt quotient;
+		if (a < b) {
+			if (r)
+				*r = a;
+			if (q)
+				*q = quotient;
+			return;
+		}
+		if (n == 1) {
+			uint64 d = b._limbs[0], rem = 0;
+			for (sizeT i = m; i-- > 0;) {
+				wide cur = ((wide) rem << 64) | a._limbs[i];
+				quotient._limbs[i] = (uint64) (cur / d);
+				rem = (uint64) (cur % d);
+			}
+			if (r)
+				*r = BigUInt(rem);
+			if (q)
+				*q = quotient;
+			return;
+		}
+		// normalize so that the top limb of the divisor has its high bit set
+		ubyte s = __builtin_clzll(b._limbs[n - 1]);
+		uint64 u[limbCount + 1] = {}, v[limbCount] = {};
+		for (sizeT i = 0; i < n; i++)
+			v[i] = (b._limbs[i] << s) | (s && i > 0 ? b._limbs[i - 1] >> (64 - s) : 0);
+		for (sizeT i = 0; i < m; i++)
+			u[i] = (a._limbs[i] << s) | (s && i > 0 ? a._limbs[i - 1] >> (64 - s) : 0);
+		u[m] = s ? a._limbs[m - 1] >> (64 - s) : 0;
+		for (sizeT j = m - n + 1; j-- > 0;) {
+			wide top = ((wide) u[j + n] << 64) | u[j + n - 1];
+			wide qhat = top / v[n - 1], rhat = top % v[n - 1];
+			while ((qhat >> 64) || qhat * v[n - 2] > ((rhat << 64) | u[j + n - 2])) {
+				qhat--;
+				rhat += v[n - 1];
+				if (rhat >> 64)
+					break;
+			}
+			uint64 carry = 0, borrow = 0;
+			for (sizeT i = 0; i < n; i++) {
+				wide p = qhat * v[i] + carry;
+				carry = (uint64) (p >> 64);
+				uint64 low = (uint64) p, cur = u[i + j];
+				u[i + j] = cur - low - borrow;
+				borrow = cur < low || cur - low < borrow;
+			}
+			uint64 cur = u[j + n];
+			u[j + n] = cur - carry - borrow;
+			borrow = cur < carry || cur - carry < borrow;
+			// qhat was one too large, add the divisor back
+			if (borrow) {
+				qhat--;
+				carry = 0;
+				for (sizeT i = 0; i < n; i++) {
+					wide sum = (wide) u[i + j] + v[i] + carry;
+					u[i + j] = (uint64) sum;
+					carry = (uint64) (sum >> 64);
+				}
+				u[j + n] += carry;
+			}
+			quotient._limbs[j] = (uint64) qhat;
+		}
+		if (r) {
+			BigUInt rem;
+			for (sizeT i = 0; i < n; i++)
+				rem._limbs[i] = (u[i] >> s) | (s ? u[i + 1] << (64 - s) : 0);
+			*r = rem;
+		}
+		if (q)
+			*q = quotient;
+	}
+
+public:
+	constexpr BigUInt() {}
+
+	constexpr BigUInt(uint64 t_value) {
+		_limbs[0] = t_value;
+	}
+
+	// keeps the low Bits bits, negative values wrap around as two's complement
+	explicit BigUInt(const BigInt &t_value) {
+		sizeT n = Algorithm::min((sizeT) *t_value.size, limbCount);
+		for (sizeT i = 0; i < n; i++)
+			_limbs[i] = t_value[i];
+		if (t_value.sign)
+			*this = -*this;
+	}
+
+	// zero-extends or truncates
+	template<sizeT OtherBits>
+	explicit constexpr BigUInt(const BigUInt<OtherBits> &t_other) {
+		for (sizeT i = 0; i < limbCount && i < BigUInt<OtherBits>::limbCount; i++)
+			_limbs[i] = t_other[i];
+	}
+
+	BigInt toBigInt() const {
+		BigInt result;
+		sizeT n = used();
+		result.resize(n);
+		for (sizeT i = 0; i < n; i++)
+			result[i] = _limbs[i];
+		return result;
+	}
+
+	constexpr uint64 &operator[](sizeT i) {
+		return _limbs[i];
+	}
+
+	constexpr uint64 operator[](sizeT i) const {
+		return _limbs[i];
+	}
+
+	constexpr uint64 *data() {
+		return _limbs;
+	}
+
+	constexpr const uint64 *data() const {
+		return _limbs;
+	}
+
+	constexpr bool isZero() const {
+		return used() == 0;
+	}
+
+	// number of significant bits, 0 for zero
+	constexpr sizeT bitLength() const {
+		sizeT n = used();
+		return n == 0 ? 0 : 64 * n - __builtin_clzll(_limbs[n - 1]);
+	}
+
+	constexpr BigUInt &operator+=(const BigUInt &other) {
+		uint64 carry = 0;
+#pragma GCC unroll 16
+		for (sizeT i = 0; i < limbCount; i++) {
+			uint64 sum = _limbs[i] + carry;
+			carry = sum < carry;
+			sum += other._limbs[i];
+			carry += sum < other._limbs[i];
+			_limbs[i] = sum;
+		}
+		return *this;
+	}
+
+	constexpr BigUInt &operator-=(const BigUInt &other) {
+		uint64 borrow = 0;
+#pragma GCC unroll 16
+		for (sizeT i = 0; i < limbCount; i++) {
+			uint64 cur = _limbs[i], diff = cur - other._limbs[i];
+			uint64 out = cur < other._limbs[i];
+			out += diff < borrow;
+			_limbs[i] = diff - borrow;
+			borrow = out;
+		}
+		return *this;
+	}
+
+	// low Bits bits of the product
+	constexpr BigUInt operator*(const BigUInt &other) const {
+		BigUInt result;
+#pragma GCC unroll 16
+		for (sizeT i = 0; i < limbCount; i++) {
+			uint64 carry = 0;
+#pragma GCC unroll 16
+			for (sizeT j = 0; j + i < limbCount; j++) {
+				wide cur = (wide) _limbs[i] * other._limbs[j] + result._limbs[i + j] + carry;
+				result._limbs[i + j] = (uint64) cur;
+				carry = (uint64) (cur >> 64);
+			}
+		}
+		return result;
+	}
+
+	constexpr BigUInt operator+(const BigUInt &other) const {
+		BigUInt result(*this);
+		return result += other;
+	}
+
+	constexpr BigUInt operator-(const BigUInt &other) const {
+		BigUInt result(*this);
+		return result -= other;
+	}
+
+	constexpr BigUInt operator-() const {
+		return BigUInt() - *this;
+	}
+
+	constexpr BigUInt &operator*=(const BigUInt &other) {
+		return *this = *this * other;
+	}
+
+	constexpr BigUInt operator/(const BigUInt &other) const {
+		BigUInt q;
+		divide(*this, other, &q, nullptr);
+		return q;
+	}
+
+	constexpr BigUInt operator%(const BigUInt &other) const {
+		BigUInt r;
+		divide(*this, other, nullptr, &r);
+		return r;
+	}
+
+	constexpr BigUInt &operator/=(const BigUInt &other) {
+		return *this = *this / other;
+	}
+
+	constexpr BigUInt &operator%=(const BigUInt &other) {
+		return *this = *this % other;
+	}
+
+	Pair<BigUInt, BigUInt> divrem(const BigUInt &other) const {
+		Pair<BigUInt, BigUInt> result;
+		divide(*this, other, &result.first, &result.second);
+		return result;
+	}
+
+	constexpr BigUInt operator<<(uint32 t_shift) const {
+		BigUInt result;
+		if (t_shift >= Bits)
+			return result;
+		sizeT limbs = t_shift >> 6;
+		ubyte s = t_shift & 63;
+#pragma GCC unroll 16
+		for (sizeT i = limbs; i < limbCount; i++)
+			result._limbs[i] = (_limbs[i - limbs] << s) | (s && i > limbs ? _limbs[i - limbs - 1] >> (64 - s) : 0);
+		return result;
+	}
+
+	constexpr BigUInt operator>>(uint32 t_shift) const {
+		BigUInt result;
+		if (t_shift >= Bits)
+			return result;
+		sizeT limbs = t_shift >> 6;
+		ubyte s = t_shift & 63;
+#pragma GCC unroll 16
+		for (sizeT i = 0; i + limbs < limbCount; i++)
+			result._limbs[i] = (_limbs[i + limbs] >> s) | (s && i + limbs + 1 < limbCount ? _limbs[i + limbs + 1] << (64 - s) : 0);
+		return result;
+	}
+
+	constexpr BigUInt &operator<<=(uint32 t_shift) {
+		return *this = *this << t_shift;
+	}
+
+	constexpr BigUInt &operator>>=(uint32 t_shift) {
+		return *this = *this >> t_shift;
+	}
+
+	constexpr BigUInt operator&(const BigUInt &other) const {
+		BigUInt result;
+		for (sizeT i = 0; i < limbCount; i++)
+			result._limbs[i] = _limbs[i] & other._limbs[i];
+		return result;
+	}
+
+	constexpr BigUInt operator|(const BigUInt &other) const {
+		BigUInt result;
+		for (sizeT i = 0; i < limbCount; i++)
+			result._limbs[i] = _limbs[i] | other._limbs[i];
+		return result;
+	}
+
+	constexpr BigUInt operator^(const BigUInt &other) const {
+		BigUInt result;
+		for (sizeT i = 0; i < limbCount; i++)
+			result._limbs[i] = _limbs[i] ^ other._limbs[i];
+		return result;
+	}
+
+	constexpr BigUInt operator~() const {
+		BigUInt result;
+		for (sizeT i = 0; i < limbCount; i++)
+			result._limbs[i] = ~_limbs[i];
+		return result;
+	}
+
+	constexpr bool operator==(const BigUInt &other) const {
+		for (sizeT i = 0; i < limbCount; i++)
+			if (_limbs[i] != other._limbs[i])
+				return false;
+		return true;
+	}
+
+	constexpr bool operator!=(const BigUInt &other) const {
+		return !(*this == other);
+	}
+
+	constexpr bool operator<(const BigUInt &other) const {
+		for (sizeT i = limbCount; i-- > 0;)
+			if (_limbs[i] != other._limbs[i])
+				return _limbs[i] < other._limbs[i];
+		return false;
+	}
+
+	constexpr bool operator>(const BigUInt &other) const {
+		return other < *this;
+	}
+
+	constexpr bool operator<=(const BigUInt &other) const {
+		return !(other < *this);
+	}
+
+	constexpr bool operator>=(const BigUInt &other) const {
+		return !(*this < other);
+	}
+};
+
+// Full product of two fixed-width numbers, twice as wide as the operands
+template<sizeT Bits>
+constexpr BigUInt<2 * Bits> mulWide(const BigUInt<Bits> &a, const BigUInt<Bits> &b) {
+	return BigUInt<2 * Bits>(a) * BigUInt<2 * Bits>(b);
+}
+
+// Two's complement counterpart of BigUInt. Addition, subtraction and multiplication are
+// the unsigned ones, division rounds toward zero and >> keeps the sign
+
+template<sizeT Bits>
+class BigSInt {
+	BigUInt<Bits> _bits;
+
+	constexpr BigUInt<Bits> magnitude() const {
+		return isNegative() ? -_bits : _bits;
+	}
+
+public:
+	static constexpr sizeT limbCount = Bits / 64;
+
+	constexpr BigSInt() {}
+
+	constexpr BigSInt(int64 t_value)
+		: _bits((uint64) t_value) {
+		if (t_value < 0)
+			for (sizeT i = 1; i < limbCount; i++)
+				_bits[i] = ~0ULL;
+	}
+
+	explicit constexpr BigSInt(const BigUInt<Bits> &t_bits)
+		: _bits(t_bits) {}
+
+	// keeps the low Bits bits of the two's complement form
+	explicit BigSInt(const BigInt &t_value)
+		: _bits(t_value) {}
+
+	BigInt toBigInt() const {
+		if (!isNegative())
+			return _bits.toBigInt();
+		BigInt result = (-_bits).toBigInt();
+		result.sign = 1;
+		return result;
+	}
+
+	// the two's complement bit pattern
+	constexpr const BigUInt<Bits> &bits() const {
+		return _bits;
+	}
+
+	constexpr uint64 operator[](sizeT i) const {
+		return _bits[i];
+	}
+
+	constexpr bool isNegative() const {
+		return _bits[limbCount - 1] >> 63;
+	}
+
+	constexpr BigSInt operator+(const BigSInt &other) const {
+		return BigSInt(_bits + other._bits);
+	}
+
+	constexpr BigSInt operator-(const BigSInt &other) const {
+		return BigSInt(_bits - other._bits);
+	}
+
+	constexpr BigSInt operator-() const {
+		return BigSInt(-_bits);
+	}
+
+	constexpr BigSInt operator*(const BigSInt &other) const {
+		return BigSInt(_bits * other._bits);
+	}
+
+	constexpr BigSInt operator/(const BigSInt &other) const {
+		BigUInt<Bits> q = magnitude() / other.magnitude();
+		return BigSInt(isNegative() != other.isNegative() ? -q : q);
+	}
+
+	// takes the sign of the dividend
+	constexpr BigSInt operator%(const BigSInt &other) const {
+		BigUInt<Bits> r = magnitude() % other.magnitude();
+		return BigSInt(isNegative() ? -r : r);
+	}
+
+	constexpr BigSInt &operator+=(const BigSInt &other) {
+		_bits += other._bits;
+		return *this;
+	}
+
+	constexpr BigSInt &operator-=(const BigSInt &other) {
+		_bits -= other._bits;
+		return *this;
+	}
+
+	constexpr BigSInt &operator*=(const BigSInt &other) {
+		_bits *= other._bits;
+		return *this;
+	}
+
+	constexpr BigSInt &operator/=(const BigSInt &other) {
+		return *this = *this / other;
+	}
+
+	constexpr BigSInt &operator%=(const BigSInt &other) {
+		return *this = *this % other;
+	}
+
+	constexpr BigSInt operator<<(uint32 t_shift) const {
+		return BigSInt(_bits << t_shift);
+	}
+
+	constexpr BigSInt operator>>(uint32 t_shift) const {
+		if (!isNegative())
+			return BigSInt(_bits >> t_shift);
+		return BigSInt(~(~_bits >> t_shift));
+	}
+
+	constexpr BigSInt operator&(const BigSInt &other) const {
+		return BigSInt(_bits & other._bits);
+	}
+
+	constexpr BigSInt operator|(const BigSInt &other) const {
+		return BigSInt(_bits | other._bits);
+	}
+
+	constexpr BigSInt operator^(const BigSInt &other) const {
+		return BigSInt(_bits ^ other._bits);
+	}
+
+	constexpr BigSInt operator~() const {
+		return BigSInt(~_bits);
+	}
+
+	constexpr bool operator==(const BigSInt &other) const {
+		return _bits == other._bits;
+	}
+
+	constexpr bool operator!=(const BigSInt &other) const {
+		return _bits != other._bits;
+	}
+
+	constexpr bool operator<(const BigSInt &other) const {
+		if (isNegative() != other.isNegative())
+			return isNegative();
+		return _bits < other._bits;
+	}
+
+	constexpr bool operator>(const BigSInt &other) const {
+		return other < *this;
+	}
+
+	constexpr bool operator<=(const BigSInt &other) const {
+		return !(other < *this);
+	}
+
+	constexpr bool operator>=(const BigSInt &other) const {
+		return !(*this < other);
+	}
+};
+
+// Compile-time check that multiplication, division and comparison really are constexpr:
+// 50! takes 215 bits, and 50! / 48! has to come out as 50 * 49
+namespace FixedBigCheck {
+	constexpr BigUInt<256> factorial(uint64 n) {
+		BigUInt<256> result(1);
+		for (uint64 i = 2; i <= n; i++)
+			result *= BigUInt<256>(i);
+		return result;
+	}
+
+	static_assert(factorial(50) / factorial(48) == BigUInt<256>(50 * 49), "BigUInt arithmetic isn't constexpr.");
+	static_assert(-BigSInt<128>((int64) 6) / BigSInt<128>((int64) 4) == BigSInt<128>((int64) -1),
+	              "BigSInt division must round toward zero.");
+}
+
+#endif //FIXED_BIG_HPP
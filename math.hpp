@@ -3,29 +3,65 @@
 
 #include <stdexcept>
 #include <cmath>
+#include <cfloat>
+#include <climits>
+#include <cstddef>
+#include <cstring>
 
 #ifndef MATH_HPP
 #define MATH_HPP
 
 namespace Math {
-	const long double pi = 3.141592653589793238462643383279502884197169399375105820974944592307816406286;
-	const long double exp = 2.718281828459045235360287471352662497757247093699959574966967627724076630353;
+	const long double pi = 3.141592653589793238462643383279502884197169399375105820974944592307816406286L;
+	const long double exp = 2.718281828459045235360287471352662497757247093699959574966967627724076630353L;
 	const long double eps = 1e-9;
 
-	long long gcd(long long a, long long b) {
-		// Find the gcd of two numbers using Euclid's algorithm
-		long long tmp;
-		while (b != 0) {
-			tmp = b;
-			b = a%b;
-			a = tmp;
+	unsigned long long binaryGcd(unsigned long long a, unsigned long long b) {
+		// Find the gcd of two numbers using Stein's binary algorithm. The trailing zeros of
+		// a - b are counted alongside min and |a - b| rather than after them, which keeps
+		// ctz off the dependency chain between iterations
+		if (a == 0 || b == 0)
+			return a | b;
+		int aZeros = __builtin_ctzll(a), bZeros = __builtin_ctzll(b);
+		int shift = aZeros < bZeros ? aZeros : bZeros;
+		b >>= bZeros;
+		while (a != 0) {
+			a >>= aZeros;
+			unsigned long long difference = a - b;
+			// the top bit only matters when a == b, where the loop ends anyway
+			aZeros = __builtin_ctzll(difference | 1ULL << 63);
+			unsigned long long smaller = a < b ? a : b;
+			// written so that it compiles to conditional moves, not to a branch
+			a = a > b ? a - b : b - a;
+			b = smaller;
 		}
-		return a;
+		return b << shift;
+	}
+
+	long long gcd(long long a, long long b) {
+		// Find the non-negative gcd of two numbers using the binary algorithm. The only
+		// one that doesn't fit in long long is 2^63, of LLONG_MIN and 0 or LLONG_MIN
+		unsigned long long result = binaryGcd(a < 0 ? -(unsigned long long) a : a, b < 0 ? -(unsigned long long) b : b);
+		if (result > LLONG_MAX)
+			throw std::overflow_error("gcd doesn't fit in long long.");
+		return result;
+	}
+
+	long long lcmFromGcd(long long a, long long b, unsigned long long t_gcd) {
+		// Find the non-negative lcm of two numbers with the gcd t_gcd, dividing before multiplying
+		if (a == 0 || b == 0)
+			return 0;
+		unsigned long long result;
+		unsigned long long absA = a < 0 ? -(unsigned long long) a : a;
+		unsigned long long absB = b < 0 ? -(unsigned long long) b : b;
+		if (__builtin_mul_overflow(absA / t_gcd, absB, &result) || result > LLONG_MAX)
+			throw std::overflow_error("lcm doesn't fit in long long.");
+		return result;
 	}
 
 	long long lcm(long long a, long long b) {
-		// Find the lcm of two numbers using Euclid's algorithm
-		return a*b/gcd(a, b);
+		// Find the non-negative lcm of two numbers, throwing if it doesn't fit in long long
+		return lcmFromGcd(a, b, binaryGcd(a < 0 ? -(unsigned long long) a : a, b < 0 ? -(unsigned long long) b : b));
 	}
 
 	long long binPow(long long t_base, long long t_power) {
@@ -50,10 +86,266 @@ namespace Math {
 		return result;
 	}
 
+	unsigned long long mulmod(unsigned long long a, unsigned long long b, unsigned long long t_mod) {
+		// Multiply two numbers modulo t_mod through a 128-bit product
+		if (t_mod == 0)
+			throw std::logic_error("Can't take remainder modulo 0.");
+		return (unsigned long long) ((unsigned __int128) a*b % t_mod);
+	}
+
+	// Arithmetic modulo an odd n < 2^64 in Montgomery form x * 2^64 mod n, where
+	// a product needs two multiplications instead of a 128-bit division
+	class Montgomery64 {
+		unsigned long long _mod, _inverse, _one, _square;
+
+	public:
+		explicit Montgomery64(unsigned long long t_mod)
+			: _mod(t_mod) {
+			if (t_mod % 2 == 0)
+				throw std::logic_error("Montgomery form needs an odd modulus.");
+			// Newton iteration for n^-1 mod 2^64, each step doubles the correct bits
+			_inverse = t_mod;
+			for (int i = 0; i < 5; i++)
+				_inverse *= 2 - t_mod*_inverse;
+			_one = -t_mod % t_mod;
+			_square = (unsigned __int128) _one*_one % t_mod;
+		}
+
+		unsigned long long mod() const {
+			return _mod;
+		}
+
+		// 1 in Montgomery form
+		unsigned long long one() const {
+			return _one;
+		}
+
+		// t * 2^-64 mod n for t < n * 2^64, as the difference of the high halves of t and
+		// m n, where m makes the low halves equal. Never overflows, even for n close to 2^64
+		unsigned long long reduce(unsigned __int128 t) const {
+			unsigned long long m = (unsigned long long) t*_inverse;
+			unsigned long long high = t >> 64, correction = ((unsigned __int128) m*_mod) >> 64;
+			return high >= correction ? high - correction : high - correction + _mod;
+		}
+
+		unsigned long long mul(unsigned long long a, unsigned long long b) const {
+			return reduce((unsigned __int128) a*b);
+		}
+
+		unsigned long long add(unsigned long long a, unsigned long long b) const {
+			return a >= _mod - b ? a - (_mod - b) : a + b;
+		}
+
+		unsigned long long toMont(unsigned long long a) const {
+			return mul(a % _mod, _square);
+		}
+
+		unsigned long long fromMont(unsigned long long a) const {
+			return reduce(a);
+		}
+
+		// a in Montgomery form, result in Montgomery form
+		unsigned long long pow(unsigned long long a, unsigned long long t_power) const {
+			unsigned long long result = _one;
+			while (t_power) {
+				if (t_power % 2)
+					result = mul(result, a);
+				a = mul(a, a);
+				t_power /= 2;
+			}
+			return result;
+		}
+	};
+
+	unsigned long long powmod(unsigned long long t_base, unsigned long long t_power, unsigned long long t_mod) {
+		// Raise number to power modulo t_mod, in Montgomery form for odd moduli
+		if (t_mod == 0)
+			throw std::logic_error("Can't take remainder modulo 0.");
+		if (t_mod % 2) {
+			Montgomery64 m(t_mod);
+			return m.fromMont(m.pow(m.toMont(t_base), t_power));
+		}
+		unsigned long long result = 1 % t_mod;
+		t_base %= t_mod;
+		while (t_power) {
+			if (t_power % 2)
+				result = mulmod(result, t_base, t_mod);
+			t_base = mulmod(t_base, t_base, t_mod);
+			t_power /= 2;
+		}
+		return result;
+	}
+
+	namespace Primes {
+		const unsigned char smallPrimes[] = {3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71, 73, 79, 83, 89, 97};
+
+		// the strong probable prime test to base t_base for odd n = d * 2^s + 1
+		bool strongProbablePrime(const Montgomery64 &m, unsigned long long t_base, unsigned long long d, int s) {
+			unsigned long long minusOne = m.mod() - m.one();
+			unsigned long long x = m.toMont(t_base);
+			if (x == 0)
+				return true;
+			x = m.pow(x, d);
+			if (x == m.one() || x == minusOne)
+				return true;
+			for (int i = 1; i < s; i++) {
+				x = m.mul(x, x);
+				if (x == minusOne)
+					return true;
+			}
+			return false;
+		}
+
+		// a factor of odd composite n other than 1 and n, by Pollard's rho with Brent's
+		// cycle detection. The differences are multiplied together and only every 128th
+		// step pays for a gcd, going back one step at a time when a batch overshoots
+		unsigned long long pollardRho(unsigned long long n) {
+			Montgomery64 m(n);
+			const unsigned long long batch = 128;
+			for (unsigned long long c = 1;; c++) {
+				unsigned long long increment = m.toMont(c);
+				auto step = [&](unsigned long long x) {
+					return m.add(m.mul(x, x), increment);
+				};
+				auto distance = [](unsigned long long a, unsigned long long b) {
+					return a > b ? a - b : b - a;
+				};
+				unsigned long long x, y = m.toMont(2), saved = y, product = m.one(), g = 1;
+				for (unsigned long long length = 1; g == 1; length *= 2) {
+					x = y;
+					for (unsigned long long i = 0; i < length; i++)
+						y = step(y);
+					for (unsigned long long done = 0; done < length && g == 1; done += batch) {
+						saved = y;
+						for (unsigned long long i = 0; i < batch && i < length - done; i++) {
+							y = step(y);
+							product = m.mul(product, distance(x, y));
+						}
+						g = binaryGcd(product, n);
+					}
+				}
+				if (g == n) {
+					do {
+						saved = step(saved);
+						g = binaryGcd(distance(x, saved), n);
+					} while (g == 1);
+				}
+				if (g != n)
+					return g;
+			}
+		}
+	}
+
+	bool isPrime(unsigned long long n) {
+		// Check if number is prime with deterministic Miller-Rabin, the bases below
+		// have no common strong pseudoprime under 2^64
+		if (n < 2)
+			return false;
+		if (n % 2 == 0)
+			return n == 2;
+		for (unsigned char p : Primes::smallPrimes) {
+			if (n % p == 0)
+				return n == p;
+		}
+		if (n < 97ULL*97)
+			return true;
+		Montgomery64 m(n);
+		int s = __builtin_ctzll(n - 1);
+		unsigned long long d = (n - 1) >> s;
+		static const unsigned long long bases32[] = {2, 7, 61};
+		static const unsigned long long bases64[] = {2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+		if (n >> 32 == 0) {
+			for (unsigned long long base : bases32)
+				if (!Primes::strongProbablePrime(m, base, d, s))
+					return false;
+			return true;
+		}
+		for (unsigned long long base : bases64)
+			if (!Primes::strongProbablePrime(m, base, d, s))
+				return false;
+		return true;
+	}
+
+	// Distinct prime factors in increasing order with their exponents,
+	// no number below 2^64 has more than 15 of them
+	struct Factorization {
+		unsigned long long primes[15];
+		unsigned char exponents[15];
+		unsigned char count = 0;
+
+		void add(unsigned long long t_prime, unsigned char t_exponent) {
+			int i = count;
+			for (; i > 0 && primes[i - 1] >= t_prime; i--) {
+				if (primes[i - 1] == t_prime) {
+					exponents[i - 1] += t_exponent;
+					return;
+				}
+			}
+			for (int j = count; j > i; j--) {
+				primes[j] = primes[j - 1];
+				exponents[j] = exponents[j - 1];
+			}
+			primes[i] = t_prime;
+			exponents[i] = t_exponent;
+			count++;
+		}
+	};
+
+	namespace Primes {
+		// adds the prime factors of odd n without small factors, each taken t_exponent times
+		void splitFactors(unsigned long long n, unsigned char t_exponent, Factorization &t_result) {
+			if (n == 1)
+				return;
+			if (isPrime(n)) {
+				t_result.add(n, t_exponent);
+				return;
+			}
+			unsigned long long d = pollardRho(n);
+			// equal parts are common for squares of primes, split them once
+			if (d <= 0xffffffffULL && d*d == n) {
+				splitFactors(d, 2*t_exponent, t_result);
+				return;
+			}
+			splitFactors(d, t_exponent, t_result);
+			splitFactors(n/d, t_exponent, t_result);
+		}
+	}
+
+	Factorization factor(unsigned long long n) {
+		// Factor number into primes with trial division by primes under 100,
+		// then Miller-Rabin and Pollard's rho
+		if (n == 0)
+			throw std::logic_error("Can't factor 0.");
+		Factorization result;
+		if (n % 2 == 0) {
+			int twos = __builtin_ctzll(n);
+			result.add(2, twos);
+			n >>= twos;
+		}
+		for (unsigned char p : Primes::smallPrimes) {
+			if (n % p == 0) {
+				unsigned char exponent = 0;
+				while (n % p == 0) {
+					n /= p;
+					exponent++;
+				}
+				result.add(p, exponent);
+			}
+		}
+		Primes::splitFactors(n, 1, result);
+		return result;
+	}
+
+	void factor(const unsigned long long *t_values, size_t n, Factorization *out) {
+		// Factor n numbers into primes
+		for (size_t i = 0; i < n; i++)
+			out[i] = factor(t_values[i]);
+	}
+
 	long double realBinPow(long double t_base, long double t_power);
 
 	long double nthRoot(long double t_base, int t_n) {
-		// Find nth root of a number using Newton's method
+		// Find nth root of a number with a Newton step from exp2(log2(x) / n)
 		if (t_n == 0)
 			throw std::logic_error("Can't take root 0 of a number.");
 		if (t_n == 1)
@@ -62,55 +354,50 @@ namespace Math {
 			return 1.0/nthRoot(t_base, -t_n);
 		if (t_base < 0  && t_n%2==0)
 			throw std::logic_error("Can't take even root of negative number.");
-		long double baseX = t_base;
-		for (int i = 0; i < 5; i++)
-			baseX /= t_n;
-		long double diff = 10;
-		long double kthX;
-		while (diff > 1e-9) {
-			kthX = ((t_n - 1.0)*baseX + t_base/realBinPow(baseX, t_n-1.0))/(1.0*t_n);
-			diff = abs(kthX-baseX);
-			baseX = kthX;
-		}
-		return baseX;
+		if (t_base == 0 || std::isinf(t_base))
+			return t_base;
+		long double x = fabsl(t_base);
+		long double root = exp2l(log2l(x)/t_n);
+		// the step squares the relative error of the estimate
+		if (std::isnormal(root))
+			root -= (root - x/realBinPow(root, t_n-1.0))/t_n;
+		return t_base < 0 ? -root : root;
 	}
 
 	long double realBinPow(long double t_base, long double t_power) {
-		// Raise real number to power using binary exponentiation
-		if (t_base < 0 && abs(t_power-floor(t_power)) > eps)
+		// Raise real number to power using exp2 and log2, with binary exponentiation
+		// for integer powers and square roots for halves and reciprocal integers
+		bool integer = t_power == floorl(t_power);
+		if (t_base < 0 && !integer)
 			throw std::logic_error("Cannot raise negative number to real power.");
-		if (abs(t_power - 0.0) < eps)
+		if (t_power == 0)
 			return 1;
-		if (abs(t_base - 0.0) < eps) {
+		if (t_base == 0) {
 			if (t_power < 0)
 				throw std::logic_error("Cannot raise 0 to negative power.");
 			return 0;
 		}
-		if (abs(t_power - 1.0) < eps)
-			return t_base;
-		if (t_power < 0)
-			return 1.0/realBinPow(t_base, -t_power);
-		if (t_power < 1) {
-			int powerToRaise = t_power*1000;
-			int rootToTake = 1000;
-			int gcdToDiv = gcd(powerToRaise, rootToTake);
-			return nthRoot(realBinPow(t_base, powerToRaise/gcdToDiv), rootToTake/gcdToDiv);
-		}
-		if (abs(t_power-floor(t_power)) > eps)
-			return realBinPow(t_base, floor(t_power))*realBinPow(t_base, t_power-floor(t_power));
-		if (t_base < 0 && abs(fmod(t_power, 2.0)-1.0) < eps)
-			return -realBinPow(-t_base, t_power);
-		long double result = 1;
-		while (t_power > 0) {
-			if (abs(fmod(t_power, 2.0)-0.0) < eps) {
-				t_power /= 2.0;
-				t_base *= t_base;
-			} else {
-				t_power -= 1.0;
-				result *= t_base;
+		// up to 2048 the rounding errors of the squarings stay below the double precision
+		if (integer && fabsl(t_power) <= 2048) {
+			long long power = fabsl(t_power);
+			long double base = t_base;
+			long double result = 1;
+			while (power) {
+				if (power % 2)
+					result *= base;
+				base *= base;
+				power /= 2;
 			}
+			return t_power < 0 ? 1.0/result : result;
 		}
-		return result;
+		if (fabsl(t_power) <= 2048 && 2*t_power == floorl(2*t_power))
+			return realBinPow(t_base, t_power - 0.5)*sqrtl(t_base);
+		long double inverse = roundl(1.0/t_power);
+		if (fabsl(inverse) <= 1e9 && (1.0L/inverse == t_power || (double) (1.0/inverse) == t_power))
+			return nthRoot(t_base, (int) inverse);
+		if (t_base < 0)
+			return fmodl(t_power, 2.0) != 0 ? -exp2l(t_power*log2l(-t_base)) : exp2l(t_power*log2l(-t_base));
+		return exp2l(t_power*log2l(t_base));
 	}
 
 	unsigned int roundToNextPowerOfTwo(unsigned int value) {
@@ -266,6 +553,504 @@ namespace Math {
 		return (pi/2.0-arctg(a));
 	}
 
+	// Array versions of sine, cosine, ln and arctg. Each element goes through the same
+	// range reduction and fixed-degree polynomial with no data-dependent branches, so
+	// several lanes are evaluated at once with the widest vectors the processor has
+	// (AVX-512, AVX2 or SSE2, picked at run time). Lanes the reduction can't handle
+	// (angles above 2^20 * pi/2, non-positive, subnormal or non-finite logarithm arguments)
+	// are recomputed with <cmath>, so the results follow IEEE instead of throwing
+	// the compensated sums below rely on every product being rounded on its own,
+	// which contraction into fused multiply-adds on FMA targets would break
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+	namespace Lanes {
+		template<int Bytes>
+		struct Width {
+			typedef double real __attribute__((vector_size(Bytes)));
+			typedef long long integer __attribute__((vector_size(Bytes)));
+			typedef unsigned long long word __attribute__((vector_size(Bytes)));
+			static const int count = Bytes / sizeof(double);
+		};
+
+		// Adding and subtracting 1.5 * 2^52 rounds to an integer, which is also
+		// left in the low mantissa bits of the sum
+		const double roundingShifter = 0x1.8p52;
+		const long long signBit = 1LL << 63;
+
+		// true if any lane of the mask is set
+		template<typename I>
+		__attribute__((always_inline)) inline bool any(const I &t_mask) {
+			long long lanes[sizeof(I) / sizeof(long long)];
+			memcpy(lanes, &t_mask, sizeof(I));
+			long long result = 0;
+			for (size_t i = 0; i < sizeof(I) / sizeof(long long); i++)
+				result |= lanes[i];
+			return result != 0;
+		}
+
+		// r = a where the mask is all ones and b where it is zero. Spelled out with bitwise
+		// operations because SSE2 has no 64-bit compares to turn masks into blends
+		template<typename R, typename I>
+		__attribute__((always_inline)) inline void select(R &r, const I &t_mask, const R &a, const R &b) {
+			r = (R) (((I) a & t_mask) | ((I) b & ~t_mask));
+		}
+
+		// p + e = a * b exactly, by Dekker's splitting into 26-bit halves
+		template<typename R>
+		__attribute__((always_inline)) inline void twoProduct(const R &a, const R &b, R &p, R &e) {
+			p = a * b;
+			R as = a * 134217729.0, bs = b * 134217729.0;
+			R ah = as - (as - a), bh = bs - (bs - b);
+			R al = a - ah, bl = b - bh;
+			e = ((ah * bh - p) + ah * bl + al * bh) + al * bl;
+		}
+
+		// sine and cosine: k = round(x * 2/pi), r = x - k * pi/2 with pi/2 in three parts,
+		// the first two of 33 bits so that k * part is exact for |k| < 2^20. r is kept as
+		// a sum r + rl of two doubles, and sin r and cos r come from the fdlibm minimax
+		// polynomials on [-pi/4, pi/4] with a first order correction for rl
+		template<bool Cosine>
+		struct SineKernel {
+			template<typename W>
+			__attribute__((always_inline)) static inline void block(const double *in, double *out) {
+				typedef typename W::real R;
+				typedef typename W::integer I;
+				R x;
+				memcpy(&x, in, sizeof(R));
+				R ax = (R) ((I) x & ~signBit);
+				R t = x * 6.36619772367581382433e-01 + roundingShifter;
+				I q = (I) t + Cosine;
+				R k = t - roundingShifter;
+				R high = x - k * 1.57079632673412561417e+00;
+				R middle = k * 6.07710050630396597660e-11;
+				R h = high - middle;
+				R tail = k * 2.02226624879595063154e-21 - ((high - h) - middle);
+				R r = h - tail;
+				R rl = (h - r) - tail;
+				R z = r * r;
+				R hz = 0.5 * z;
+				R w = 1.0 - hz;
+				R s = r + (r * z * (-1.66666666666666324348e-01 + z * (8.33333333332248946124e-03
+					+ z * (-1.98412698298579493134e-04 + z * (2.75573137070700676789e-06
+					+ z * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10))))) + rl * w);
+				R c = w + (((1.0 - w) - hz) + (z * z * (4.16666666666666019037e-02 + z * (-1.38888888888741095749e-03
+					+ z * (2.48015872894767294178e-05 + z * (-2.75573143513906633035e-07
+					+ z * (2.08757232129817482790e-09 + z * -1.13596475577881948265e-11))))) - r * rl));
+				R result;
+				select(result, -(q & 1), c, s);
+				result = (R) ((I) result ^ ((q & 2) << 62));
+				// sin x rounds to x below 2^-26, which also keeps the sign of -0
+				if (!Cosine)
+					result = ax < 0x1p-26 ? x : result;
+				memcpy(out, &result, sizeof(R));
+				I special = (ax > 1.64933614313464134203e+06) | (ax != ax);
+				if (any(special))
+					for (int i = 0; i < W::count; i++)
+						if (special[i])
+							out[i] = Cosine ? std::cos(in[i]) : std::sin(in[i]);
+			}
+		};
+
+		// ln: x = m * 2^e with m in [sqrt(2)/2, sqrt(2)), then the fdlibm polynomial
+		// in s = (m - 1) / (m + 1) and ln 2 in two parts
+		struct LnKernel {
+			template<typename W>
+			__attribute__((always_inline)) static inline void block(const double *in, double *out) {
+				typedef typename W::real R;
+				typedef typename W::integer I;
+				R x;
+				memcpy(&x, in, sizeof(R));
+				I bits = (I) x;
+				R m = (R) ((bits & 0x000fffffffffffffLL) | 0x3ff0000000000000LL);
+				I above = m > 1.41421356237309504880;
+				select(m, above, m * 0.5, m);
+				// biased exponent as a double, exact through the mantissa of 2^52
+				I biased = (I) (((typename W::word) bits >> 52) & 0x7ff) - above;
+				R e = (R) (biased | 0x4330000000000000LL) - (0x1p52 + 1023.0);
+				R f = m - 1.0;
+				R s = f / (2.0 + f);
+				R z = s * s;
+				R w = z * z;
+				R odd = z * (6.666666666666735130e-01 + w * (2.857142874366239149e-01
+					+ w * (1.818357216161805012e-01 + w * 1.479819860511658591e-01)));
+				R even = w * (3.999999999940941908e-01 + w * (2.222219843214978396e-01 + w * 1.531383769920937332e-01));
+				R h = 0.5 * f * f;
+				R result = e * 6.93147180369123816490e-01 - ((h - (s * (h + odd + even) + e * 1.90821492927058770002e-10)) - f);
+				memcpy(out, &result, sizeof(R));
+				I special = ~((x >= DBL_MIN) & (x <= DBL_MAX));
+				if (any(special))
+					for (int i = 0; i < W::count; i++)
+						if (special[i])
+							out[i] = std::log(in[i]);
+			}
+		};
+
+		// arctg: |x| is moved into [0, 0.66] by atan x = pi/2 + atan(-1/x) or
+		// pi/4 + atan((x - 1) / (x + 1)), then the cephes rational approximation
+		struct ArctgKernel {
+			template<typename W>
+			__attribute__((always_inline)) static inline void block(const double *in, double *out) {
+				typedef typename W::real R;
+				typedef typename W::integer I;
+				R x;
+				memcpy(&x, in, sizeof(R));
+				I sign = (I) x & signBit;
+				R ax = (R) ((I) x & ~signBit);
+				I large = ax > 2.41421356237309504880;
+				I middle = (ax > 0.66) & ~large;
+				R zero = R{}, y, more, a;
+				select(y, middle, zero + (double) (pi / 4), zero);
+				select(y, large, zero + (double) (pi / 2), y);
+				select(more, middle, zero + 3.061616997868382943065e-17, zero);
+				select(more, large, zero + 6.123233995736765886130e-17, more);
+				select(a, middle, (ax - 1.0) / (ax + 1.0), ax);
+				select(a, large, -1.0 / ax, a);
+				R z = a * a;
+				R p = (((-8.750608600031904122785e-01 * z - 1.615753718733365076637e+01) * z
+					- 7.500855792314704667340e+01) * z - 1.228866684490136173410e+02) * z - 6.485021904942025371773e+01;
+				R d = ((((z + 2.485846490142306297962e+01) * z + 1.650270098316988542046e+02) * z
+					+ 4.328810604912902668951e+02) * z + 4.853903996359136964868e+02) * z + 1.945506571482613964425e+02;
+				R result = y + ((a * (z * p / d) + a) + more);
+				result = (R) ((I) result ^ sign);
+				memcpy(out, &result, sizeof(R));
+			}
+		};
+
+		// x^y = exp(y log x). log x = e ln 2 + log m with m in [sqrt(2)/2, sqrt(2)) is the
+		// fdlibm formula f - f^2/2 + s (f^2/2 + R(s)), carried out in two doubles so that
+		// its relative error stays below 2^-59. y log x is formed exactly as a product and
+		// exp follows fdlibm with the low part folded into the reduced argument. The error
+		// of the result still grows with |y log x|, by up to 2^-59 |y log x| relative.
+		// Lanes with a base that is not a positive normal number or a result that may
+		// overflow or underflow go to std::pow
+		struct PowKernel {
+			template<typename W>
+			__attribute__((always_inline)) static inline void block(const double *t_base, const double *t_power, size_t t_stride, double *out) {
+				typedef typename W::real R;
+				typedef typename W::integer I;
+				R x, y;
+				memcpy(&x, t_base, sizeof(R));
+				if (t_stride)
+					memcpy(&y, t_power, sizeof(R));
+				else
+					y = R{} + t_power[0];
+				I bits = (I) x;
+				R m = (R) ((bits & 0x000fffffffffffffLL) | 0x3ff0000000000000LL);
+				I above = m > 1.41421356237309504880;
+				select(m, above, m * 0.5, m);
+				I biased = (I) (((typename W::word) bits >> 52) & 0x7ff) - above;
+				R e = (R) (biased | 0x4330000000000000LL) - (0x1p52 + 1023.0);
+				R f = m - 1.0;
+				R t = 2.0 + f;
+				R s = f / t;
+				// s + sl = f / (2 + f), where f - 2s and the rest are exact by Sterbenz' lemma
+				R sp, se;
+				twoProduct(s, f, sp, se);
+				R sl = (((f - 2.0 * s) - sp) - se) / t;
+				// R = Lg1 z + rest in two doubles, where z = s^2
+				R zh, zl;
+				twoProduct(s, s, zh, zl);
+				zl = zl + 2.0 * s * sl;
+				R w = zh * zh;
+				R rest = zh * w * (2.857142874366239149e-01 + w * (1.818357216161805012e-01 + w * 1.479819860511658591e-01))
+					+ w * (3.999999999940941908e-01 + w * (2.222219843214978396e-01 + w * 1.531383769920937332e-01));
+				R lg1 = R{} + 6.666666666666735130e-01;
+				R gh, gl;
+				twoProduct(lg1, zh, gh, gl);
+				gl = gl + (lg1 * zl + rest);
+				// hh + hl = f^2 / 2, then ch + cl = s (f^2 / 2 + R)
+				R hh, hl;
+				twoProduct(f, f, hh, hl);
+				hh = hh * 0.5;
+				hl = hl * 0.5;
+				R u = hh + gh;
+				R ul = ((hh - u) + gh) + hl + gl;
+				R ch, cl;
+				twoProduct(s, u, ch, cl);
+				cl = cl + (s * ul + sl * u);
+				// f - hh + ch, each sum with its rounding error, then e ln 2 with ln 2 in two parts
+				R a = f - hh;
+				R al = ((f - a) - hh) - hl + cl;
+				R b = a + ch;
+				R bl = ((a - b) + ch) + al;
+				R eh = e * 6.93147180369123816490e-01;
+				R lh = eh + b;
+				R ll = ((eh - lh) + b) + (bl + e * 1.90821492927058770002e-10);
+				// th + tl = y log x
+				R th, tl;
+				twoProduct(y, lh, th, tl);
+				tl = tl + y * ll;
+				R sum = th + tl;
+				tl = (th - sum) + tl;
+				th = sum;
+				R kt = th * 1.44269504088896338700e+00 + roundingShifter;
+				I k = (I) kt;
+				R kd = kt - roundingShifter;
+				R hi = th - kd * 6.93147180369123816490e-01;
+				R lo = kd * 1.90821492927058770002e-10 - tl;
+				R r = hi - lo;
+				R rr = r * r;
+				R c = r - rr * (1.66666666666666019037e-01 + rr * (-2.77777777770155933842e-03
+					+ rr * (6.61375632143793436117e-05 + rr * (-1.65339022054652515390e-06 + rr * 4.13813679705723846039e-08))));
+				R result = 1.0 - ((lo - (r * c) / (2.0 - c)) - hi);
+				result = (R) ((I) result + (k << 52));
+				memcpy(out, &result, sizeof(R));
+				R ath = (R) ((I) th & ~signBit);
+				I special = ~((x >= DBL_MIN) & (x <= DBL_MAX) & (ath < 708.0));
+				if (any(special))
+					for (int i = 0; i < W::count; i++)
+						if (special[i])
+							out[i] = std::pow(t_base[i], t_power[i * t_stride]);
+			}
+
+			// t_stride is 1 for an array of powers and 0 for one power shared by all bases
+			template<typename W>
+			__attribute__((always_inline)) static inline void run(const double *t_base, const double *t_power, size_t t_stride, double *out, size_t n) {
+				size_t i = 0;
+				for (; i + W::count <= n; i += W::count)
+					block<W>(t_base + i, t_power + i * t_stride, t_stride, out + i);
+				if (i < n) {
+					double x[W::count], y[W::count] = {}, result[W::count];
+					for (int j = 0; j < W::count; j++)
+						x[j] = 1.0;
+					memcpy(x, t_base + i, (n - i) * sizeof(double));
+					memcpy(y, t_power + i * t_stride, (t_stride ? n - i : 1) * sizeof(double));
+					block<W>(x, y, t_stride, result);
+					memcpy(out + i, result, (n - i) * sizeof(double));
+				}
+			}
+		};
+
+		// gcd of pairs: binaryGcd on every lane, with two vectors in flight so that one's
+		// dependency chain runs while the other's waits. A lane is done once its a is 0,
+		// and keeps its b from then on. Trailing zeros are read off the exponent of
+		// (double) (x & -x), a conversion only AVX-512 DQ has without going through scalars
+		struct GcdKernel {
+			template<typename W>
+			__attribute__((always_inline)) static inline void trailingZeros(const typename W::word &x, typename W::word &out) {
+				typedef typename W::word U;
+				typename W::real power = __builtin_convertvector(x & -x, typename W::real);
+				U bits;
+				memcpy(&bits, &power, sizeof(U));
+				out = (bits >> 52) - 1023;
+			}
+
+			template<typename W>
+			__attribute__((always_inline)) static inline void block(const long long *t_a, const long long *t_b, long long *out) {
+				typedef typename W::word U;
+				typedef typename W::integer I;
+				U a[2], b[2], zero[2], either[2], shift[2], aZeros[2];
+				for (int h = 0; h < 2; h++) {
+					I x, y;
+					memcpy(&x, t_a + h * W::count, sizeof(I));
+					memcpy(&y, t_b + h * W::count, sizeof(I));
+					a[h] = (U) ((x ^ (x >> 63)) - (x >> 63));
+					b[h] = (U) ((y ^ (y >> 63)) - (y >> 63));
+					// gcd(x, 0) is |x|, those lanes run on 1 and 1 and are patched at the end
+					zero[h] = (U) (a[h] == 0) | (U) (b[h] == 0);
+					either[h] = a[h] | b[h];
+					select(a[h], zero[h], (U) {} + 1, a[h]);
+					select(b[h], zero[h], (U) {} + 1, b[h]);
+					U bZeros;
+					trailingZeros<W>(a[h] | b[h], shift[h]);
+					trailingZeros<W>(a[h], aZeros[h]);
+					trailingZeros<W>(b[h], bZeros);
+					b[h] >>= bZeros;
+				}
+				while (any(a[0] | a[1])) {
+					for (int h = 0; h < 2; h++) {
+						a[h] >>= aZeros[h];
+						U running = (U) (a[h] != 0);
+						U difference = a[h] - b[h];
+						trailingZeros<W>(difference, aZeros[h]);
+						U less = (U) (a[h] < b[h]), smaller, larger;
+						select(smaller, less, a[h], b[h]);
+						select(larger, less, b[h], a[h]);
+						select(b[h], running, smaller, b[h]);
+						a[h] = (larger - smaller) & running;
+					}
+				}
+				for (int h = 0; h < 2; h++) {
+					U result = b[h] << shift[h];
+					select(result, zero[h], either[h], result);
+					memcpy(out + h * W::count, &result, sizeof(U));
+				}
+			}
+
+			template<typename W>
+			__attribute__((always_inline)) static inline void run(const long long *t_a, const long long *t_b, long long *out, size_t n) {
+				size_t i = 0;
+				for (; i + 2 * W::count <= n; i += 2 * W::count)
+					block<W>(t_a + i, t_b + i, out + i);
+				if (i < n) {
+					long long x[2 * W::count] = {}, y[2 * W::count] = {}, result[2 * W::count];
+					memcpy(x, t_a + i, (n - i) * sizeof(long long));
+					memcpy(y, t_b + i, (n - i) * sizeof(long long));
+					block<W>(x, y, result);
+					memcpy(out + i, result, (n - i) * sizeof(long long));
+				}
+			}
+		};
+
+		// runs a kernel of one argument over arrays
+		template<typename K>
+		struct Unary {
+			template<typename W>
+			__attribute__((always_inline)) static inline void run(const double *in, double *out, size_t n) {
+				size_t i = 0;
+				for (; i + W::count <= n; i += W::count)
+					K::template block<W>(in + i, out + i);
+				if (i < n) {
+					double x[W::count] = {}, y[W::count];
+					memcpy(x, in + i, (n - i) * sizeof(double));
+					K::template block<W>(x, y);
+					memcpy(out + i, y, (n - i) * sizeof(double));
+				}
+			}
+		};
+
+#if defined(__x86_64__) || defined(__i386__)
+		template<typename K, typename... A>
+		__attribute__((target("avx512f"))) void runAvx512(A... t_args) {
+			K::template run<Width<64>>(t_args...);
+		}
+
+		template<typename K, typename... A>
+		__attribute__((target("avx512f,avx512dq"))) void runAvx512dq(A... t_args) {
+			K::template run<Width<64>>(t_args...);
+		}
+
+		template<typename K, typename... A>
+		__attribute__((target("avx2"))) void runAvx2(A... t_args) {
+			K::template run<Width<32>>(t_args...);
+		}
+#endif
+
+		template<typename K, typename... A>
+		void runAll(A... t_args) {
+#if defined(__x86_64__) || defined(__i386__)
+			static const int level = __builtin_cpu_supports("avx512f") ? 2 : (__builtin_cpu_supports("avx2") ? 1 : 0);
+			if (level == 2)
+				return runAvx512<K>(t_args...);
+			if (level == 1)
+				return runAvx2<K>(t_args...);
+#endif
+			K::template run<Width<16>>(t_args...);
+		}
+
+		template<typename K>
+		void mapAll(const double *in, double *out, size_t n) {
+			runAll<Unary<K>>(in, out, n);
+		}
+	}
+#pragma GCC pop_options
+
+	void sine(const double *in, double *out, size_t n) {
+		// Calculate sine of n numbers, within 1 ulp
+		Lanes::mapAll<Lanes::SineKernel<false>>(in, out, n);
+	}
+
+	void cosine(const double *in, double *out, size_t n) {
+		// Calculate cosine of n numbers, within 1 ulp
+		Lanes::mapAll<Lanes::SineKernel<true>>(in, out, n);
+	}
+
+	void ln(const double *in, double *out, size_t n) {
+		// Calculate natural logarithm of n numbers, within 1 ulp
+		Lanes::mapAll<Lanes::LnKernel>(in, out, n);
+	}
+
+	void arctg(const double *in, double *out, size_t n) {
+		// Calculate arctangent of n numbers, within 1 ulp
+		Lanes::mapAll<Lanes::ArctgKernel>(in, out, n);
+	}
+
+	void realBinPow(const double *t_base, const double *t_power, double *out, size_t n) {
+		// Raise n numbers to n powers through log and exp, as std::pow does for every pair
+		Lanes::runAll<Lanes::PowKernel>(t_base, t_power, (size_t) 1, out, n);
+	}
+
+	void realBinPow(const double *t_base, double t_power, double *out, size_t n) {
+		// Raise n numbers to the same power, with exact paths for the powers that need
+		// at most one rounding and log and exp for the rest
+		if (t_power == 0) {
+			for (size_t i = 0; i < n; i++)
+				out[i] = 1.0;
+		} else if (t_power == 1) {
+			memmove(out, t_base, n * sizeof(double));
+		} else if (t_power == 2) {
+			for (size_t i = 0; i < n; i++)
+				out[i] = t_base[i] * t_base[i];
+		} else if (t_power == -1) {
+			for (size_t i = 0; i < n; i++)
+				out[i] = 1.0 / t_base[i];
+		} else if (t_power == 0.5) {
+			// + 0.0 turns the square root of -0 into +0, as pow does
+			for (size_t i = 0; i < n; i++)
+				out[i] = t_base[i] == -INFINITY ? INFINITY : std::sqrt(t_base[i]) + 0.0;
+		} else {
+			Lanes::runAll<Lanes::PowKernel>(t_base, &t_power, (size_t) 0, out, n);
+		}
+	}
+
+	void gcdPairsWrapping(const long long *a, const long long *b, long long *out, size_t n) {
+		// Calculate the gcds of n pairs, sixteen at a time on AVX-512 DQ and one by one
+		// with binaryGcd elsewhere, where the lanes lose to it. out may be a or b.
+		// A gcd of 2^63 wraps to LLONG_MIN
+#if defined(__x86_64__) || defined(__i386__)
+		static const bool lanes = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq");
+		if (lanes)
+			return Lanes::runAvx512dq<Lanes::GcdKernel>(a, b, out, n);
+#endif
+		for (size_t i = 0; i < n; i++)
+			out[i] = binaryGcd(a[i] < 0 ? -(unsigned long long) a[i] : a[i], b[i] < 0 ? -(unsigned long long) b[i] : b[i]);
+	}
+
+	void gcdPairs(const long long *a, const long long *b, long long *out, size_t n) {
+		// Calculate the gcds of n pairs, throwing like gcd once all are done if one of
+		// them came to 2^63. out may be a or b
+		gcdPairsWrapping(a, b, out, n);
+		bool wrapped = false;
+		for (size_t i = 0; i < n; i++)
+			wrapped |= out[i] < 0;
+		if (wrapped)
+			throw std::overflow_error("gcd doesn't fit in long long.");
+	}
+
+	long long gcdAll(const long long *t_values, size_t n) {
+		// Calculate the gcd of n numbers, 0 for none. The running gcd soon gets small next
+		// to the values, so one division brings each value down to its size before binaryGcd
+		unsigned long long result = 0;
+		for (size_t i = 0; i < n && result != 1; i++) {
+			unsigned long long x = t_values[i] < 0 ? -(unsigned long long) t_values[i] : t_values[i];
+			result = result == 0 ? x : binaryGcd(result, x % result);
+		}
+		if (result > LLONG_MAX)
+			throw std::overflow_error("gcd doesn't fit in long long.");
+		return result;
+	}
+
+	void lcmPairs(const long long *a, const long long *b, long long *out, size_t n) {
+		// Calculate the lcms of n pairs from their gcds, throwing if one doesn't fit
+		// in long long. out may be a or b
+		const size_t chunk = 256;
+		long long gcds[chunk];
+		for (size_t i = 0; i < n; i += chunk) {
+			size_t count = n - i < chunk ? n - i : chunk;
+			gcdPairsWrapping(a + i, b + i, gcds, count);
+			for (size_t j = 0; j < count; j++)
+				out[i + j] = lcmFromGcd(a[i + j], b[i + j], gcds[j]);
+		}
+	}
+
+	long long lcmAll(const long long *t_values, size_t n) {
+		// Calculate the lcm of n numbers, 1 for none, throwing if it doesn't fit in long long
+		long long result = 1;
+		for (size_t i = 0; i < n && result != 0; i++)
+			result = lcm(result, t_values[i]);
+		return result;
+	}
+
 }
 
 #endif // MATH_HPP
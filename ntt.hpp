@@ -0,0 +1,223 @@
+// Artem Mikheev 2020
+// GNU GPLv3 License
+
+#include "algorithm.hpp"
+#include "thread_pool.hpp"
+#include "vartypes.hpp"
+#include <cstdint>
+
+#ifndef NTT_HPP
+#define NTT_HPP
+
+// Number theoretic transforms modulo word-size primes, shared by BigInt multiplication
+// and the exact modular convolution
+
+namespace Limbs {
+	typedef unsigned __int128 wide;
+
+	// transform stages of more than parallelChunk butterflies are split over a pool
+	const sizeT parallelChunk = 1 << 14;
+
+	// Arithmetic modulo a word-size prime p < 2^62. Transform butterflies use Shoup's
+	// precomputed-quotient multiplication and keep values lazily reduced in [0, 2p),
+	// general products use Montgomery form (R = 2^64).
+	struct NttPrime {
+		uint64 p, pInv, one, r2, root;
+
+		NttPrime(uint64 t_p, uint64 t_root)
+			: p(t_p),
+			  root(t_root) {
+			// Newton iteration for p^-1 mod 2^64, each step doubles the correct bits
+			uint64 inv = p;
+			for (ubyte i = 0; i < 5; i++)
+				inv *= 2 - p * inv;
+			pInv = -inv;
+			one = (uint64) ((((wide) 1) << 64) % p);
+			r2 = (uint64) (((wide) one * one) % p);
+		}
+
+		// t < 2^127, result in [0, 2p)
+		inline uint64 reduceLazy(wide t) const {
+			uint64 m = (uint64) t * pInv;
+			return (uint64) ((t + (wide) m * p) >> 64);
+		}
+
+		inline uint64 reduce(wide t) const {
+			uint64 res = reduceLazy(t);
+			return res >= p ? res - p : res;
+		}
+
+		inline uint64 mul(uint64 a, uint64 b) const {
+			return reduce((wide) a * b);
+		}
+
+		// Works for any a < 2^64, not only a < p
+		inline uint64 toMont(uint64 a) const {
+			return reduce((wide) a * r2);
+		}
+
+		inline uint64 add(uint64 a, uint64 b) const {
+			uint64 s = a + b;
+			return s >= p ? s - p : s;
+		}
+
+		inline uint64 sub(uint64 a, uint64 b) const {
+			return a >= b ? a - b : a + p - b;
+		}
+
+		// a in Montgomery form, result in Montgomery form
+		uint64 pow(uint64 a, uint64 e) const {
+			uint64 result = one;
+			while (e) {
+				if (e & 1)
+					result = mul(result, a);
+				a = mul(a, a);
+				e >>= 1;
+			}
+			return result;
+		}
+
+		// floor(w * 2^64 / p) for a plain w < p
+		inline uint64 shoup(uint64 w) const {
+			return (uint64) ((((wide) w) << 64) / p);
+		}
+
+		// a * w mod p in [0, 2p) for any a < 2^64
+		inline uint64 mulShoup(uint64 a, uint64 w, uint64 wShoup) const {
+			uint64 q = (uint64) (((wide) a * wShoup) >> 64);
+			return a * w - q * p;
+		}
+	};
+
+	// c*2^k + 1 primes with primitive roots, transforms up to 2^55 points
+	inline const NttPrime &nttPrime(ubyte i) {
+		static const NttPrime primes[3] = {
+			NttPrime(4179340454199820289ULL, 3),
+			NttPrime(2485986994308513793ULL, 5),
+			NttPrime(1945555039024054273ULL, 5)
+		};
+		return primes[i];
+	}
+
+	// calls f(lo, hi) on consecutive pieces of [0, n), in parallel when there is a pool
+	template<typename F>
+	void forRanges(ThreadPool *pool, sizeT n, const F &f) {
+		if (pool == nullptr || n <= parallelChunk) {
+			f(0, n);
+			return;
+		}
+		pool->parallelFor((n + parallelChunk - 1) / parallelChunk, [&](sizeT i) {
+			f(i * parallelChunk, Algorithm::min(n, (i + 1) * parallelChunk));
+		});
+	}
+
+	// roots[len + j] = w^j for the 2len-th root of unity w, for every power of two len < n,
+	// stored as plain residues next to their Shoup quotients
+	inline void nttRoots(uint64 *roots, uint64 *rootsShoup, sizeT n, const NttPrime &m, bool inverse) {
+		for (sizeT len = 1; len < n; len <<= 1) {
+			uint64 w = m.pow(m.toMont(m.root), (m.p - 1) / (2 * len));
+			if (inverse)
+				w = m.pow(w, m.p - 2);
+			w = m.reduce(w);
+			uint64 wShoup = m.shoup(w);
+			roots[len] = 1;
+			for (sizeT j = 1; j < len; j++) {
+				uint64 cur = m.mulShoup(roots[len + j - 1], w, wShoup);
+				roots[len + j] = cur >= m.p ? cur - m.p : cur;
+			}
+			for (sizeT j = 0; j < len; j++)
+				rootsShoup[len + j] = m.shoup(roots[len + j]);
+		}
+	}
+
+	// Decimation in frequency, natural order in, bit-reversed order out, values in [0, 2p).
+	// Butterfly t of a stage pairs a[i + j] with a[i + j + len] for j = t % len and
+	// i = 2 * (t - j), so a stage splits into independent ranges of t
+	inline void nttForward(uint64 *a, sizeT n, const uint64 *roots, const uint64 *rootsShoup, const NttPrime &m,
+	                       ThreadPool *pool = nullptr) {
+		uint64 twoP = 2 * m.p;
+		for (sizeT len = n >> 1; len >= 1; len >>= 1) {
+			forRanges(pool, n >> 1, [&](sizeT lo, sizeT hi) {
+				while (lo < hi) {
+					sizeT j = lo & (len - 1), end = Algorithm::min(len, j + (hi - lo));
+					uint64 *x = a + 2 * (lo - j), *y = x + len;
+					lo += end - j;
+					for (; j < end; j++) {
+						uint64 u = x[j], v = y[j];
+						uint64 s = u + v;
+						x[j] = s >= twoP ? s - twoP : s;
+						y[j] = m.mulShoup(u - v + twoP, roots[len + j], rootsShoup[len + j]);
+					}
+				}
+			});
+		}
+	}
+
+	// Decimation in time, bit-reversed order in, natural order out, result scaled by n
+	inline void nttInverse(uint64 *a, sizeT n, const uint64 *roots, const uint64 *rootsShoup, const NttPrime &m,
+	                       ThreadPool *pool = nullptr) {
+		uint64 twoP = 2 * m.p;
+		for (sizeT len = 1; len < n; len <<= 1) {
+			forRanges(pool, n >> 1, [&](sizeT lo, sizeT hi) {
+				while (lo < hi) {
+					sizeT j = lo & (len - 1), end = Algorithm::min(len, j + (hi - lo));
+					uint64 *x = a + 2 * (lo - j), *y = x + len;
+					lo += end - j;
+					for (; j < end; j++) {
+						uint64 u = x[j], v = m.mulShoup(y[j], roots[len + j], rootsShoup[len + j]);
+						uint64 s = u + v;
+						x[j] = s >= twoP ? s - twoP : s;
+						y[j] = u - v + twoP;
+						y[j] = y[j] >= twoP ? y[j] - twoP : y[j];
+					}
+				}
+			});
+		}
+	}
+
+	// Cyclic convolution of a and b (zero-padded to n, a power of two) modulo m, of which
+	// fa[0, len) is left as plain residues in [0, p). fb, w and wShoup are n words
+	// of scratch each; with b == nullptr a is squared and fb is not touched
+	inline void nttConvolve(uint64 *fa, const uint64 *a, sizeT an, const uint64 *b, sizeT bn, sizeT n, sizeT len,
+	                        uint64 *fb, uint64 *w, uint64 *wShoup, const NttPrime &m, ThreadPool *pool = nullptr) {
+		// multiplying by 1 with Shoup's method brings limbs into [0, 2p)
+		uint64 oneShoup = m.shoup(1);
+		nttRoots(w, wShoup, n, m, false);
+		forRanges(pool, n, [&](sizeT lo, sizeT hi) {
+			for (sizeT i = lo; i < hi; i++)
+				fa[i] = i < an ? m.mulShoup(a[i], 1, oneShoup) : 0;
+		});
+		nttForward(fa, n, w, wShoup, m, pool);
+		// pointwise Montgomery products leave a factor R^-1 in every value
+		if (b == nullptr) {
+			forRanges(pool, n, [&](sizeT lo, sizeT hi) {
+				for (sizeT i = lo; i < hi; i++)
+					fa[i] = m.reduceLazy((wide) fa[i] * fa[i]);
+			});
+		} else {
+			forRanges(pool, n, [&](sizeT lo, sizeT hi) {
+				for (sizeT i = lo; i < hi; i++)
+					fb[i] = i < bn ? m.mulShoup(b[i], 1, oneShoup) : 0;
+			});
+			nttForward(fb, n, w, wShoup, m, pool);
+			forRanges(pool, n, [&](sizeT lo, sizeT hi) {
+				for (sizeT i = lo; i < hi; i++)
+					fa[i] = m.reduceLazy((wide) fa[i] * fb[i]);
+			});
+		}
+		nttRoots(w, wShoup, n, m, true);
+		nttInverse(fa, n, w, wShoup, m, pool);
+		// multiplying by R / n mod p undoes both the transform scaling and the R^-1
+		uint64 scale = m.reduce(m.pow(m.toMont(n), m.p - 2));
+		scale = m.reduce((wide) scale * m.r2);
+		uint64 scaleShoup = m.shoup(scale);
+		forRanges(pool, len, [&](sizeT lo, sizeT hi) {
+			for (sizeT i = lo; i < hi; i++) {
+				uint64 cur = m.mulShoup(fa[i], scale, scaleShoup);
+				fa[i] = cur >= m.p ? cur - m.p : cur;
+			}
+		});
+	}
+}
+
+#endif //NTT_HPP
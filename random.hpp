@@ -1,10 +1,24 @@
 // Artem Mikheev 2019
 // GNU GPLv3 License
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
 #ifndef RANDOM_HPP
 #define RANDOM_HPP
 
 // Various random generators in 32 and 64 bit variations
+//
+// Each scalar generator can skip ahead with jump(steps) in logarithmic time;
+// jump() and long_jump() skip jumpSteps and longJumpSteps draws, so the
+// draws between two jumps form a stream that doesn't overlap its
+// neighbours. split() returns a child seeded from this generator's output,
+// which starts at an unrelated point of the period. randomStream() below
+// gives deterministic non-overlapping streams for parallel work.
 
 class linear32 {
 	unsigned long _x;
@@ -24,10 +38,42 @@ public:
 			  _c(2147483587UL),
 			  _m(4294967291UL) {}
 
+	// The period is 429496729, so long jumps only give 25 streams
+	static constexpr unsigned long long jumpSteps = 1ULL << 16;
+	static constexpr unsigned long long longJumpSteps = 1ULL << 24;
+
 	unsigned long operator()() {
 		_x = (_a * _x + _c) % _m;
 		return _x;
 	}
+
+	void jump(unsigned long long t_steps) {
+		if (t_steps == 0)
+			return;
+		// The first step reduces a seed above the modulus
+		operator()();
+		// Compose x -> ax + c with itself t_steps - 1 times
+		unsigned long long a = 1, c = 0, stepA = _a, stepC = _c;
+		for (unsigned long long steps = t_steps - 1; steps; steps >>= 1) {
+			if (steps & 1) {
+				a = a * stepA % _m;
+				c = (stepA * c + stepC) % _m;
+			}
+			stepC = (stepA * stepC + stepC) % _m;
+			stepA = stepA * stepA % _m;
+		}
+		_x = (a * _x + c) % _m;
+	}
+
+	void jump() {
+		jump(jumpSteps);
+	}
+
+	void long_jump() {
+		jump(longJumpSteps);
+	}
+
+	linear32 split();
 };
 
 class linear64 {
@@ -35,6 +81,37 @@ class linear64 {
 	unsigned long long _a;
 	unsigned long long _c;
 	unsigned long long _m;
+
+	// x -> ax + c applied t_steps times with arithmetic modulo 2^64
+	unsigned long long advance(unsigned long long t_x, unsigned long long t_steps) const {
+		unsigned long long a = 1, c = 0, stepA = _a, stepC = _c;
+		for (; t_steps; t_steps >>= 1) {
+			if (t_steps & 1) {
+				a *= stepA;
+				c = stepA * c + stepC;
+			}
+			stepC = stepA * stepC + stepC;
+			stepA *= stepA;
+		}
+		return a * t_x + c;
+	}
+
+	// Number of steps modulo 2^64 from t_from to t_to. The map has full
+	// period, so the low i bits of the state cycle with period 2^i and each
+	// bit of the distance is found by comparing one more bit of the state
+	unsigned long long distance(unsigned long long t_from, unsigned long long t_to) const {
+		unsigned long long steps = 0, stepA = _a, stepC = _c;
+		for (int bit = 0; bit < 64; bit++) {
+			if (((t_from ^ t_to) >> bit) & 1) {
+				t_from = stepA * t_from + stepC;
+				steps |= 1ULL << bit;
+			}
+			stepC = stepA * stepC + stepC;
+			stepA *= stepA;
+		}
+		return steps;
+	}
+
 public:
 	linear64()
 			: _x(13ULL),
@@ -48,10 +125,38 @@ public:
 			  _c(1442695040888963407ULL),
 			  _m(18446744073709551615ULL) {}
 
+	static constexpr unsigned long long jumpSteps = 1ULL << 32;
+	static constexpr unsigned long long longJumpSteps = 1ULL << 48;
+
 	unsigned long long operator()() {
 		_x = (_a * _x + _c) % _m;
 		return _x;
 	}
+
+	void jump(unsigned long long t_steps) {
+		// The reduction modulo 2^64 - 1 only matters for the state that steps
+		// to 2^64 - 1, which goes to 0 instead. So the walk follows the LCG
+		// modulo 2^64 up to that state and then cycles from 0 back to it
+		unsigned long long inverse = _a;
+		for (int i = 0; i < 5; i++)
+			inverse *= 2 - _a * inverse;
+		unsigned long long last = inverse * (_m - _c);
+		unsigned long long toLast = distance(_x, last);
+		if (t_steps <= toLast)
+			_x = advance(_x, t_steps);
+		else
+			_x = advance(0, (t_steps - toLast - 1) % (distance(0, last) + 1));
+	}
+
+	void jump() {
+		jump(jumpSteps);
+	}
+
+	void long_jump() {
+		jump(longJumpSteps);
+	}
+
+	linear64 split();
 };
 
 class splitmix32 {
@@ -63,6 +168,9 @@ public:
 	splitmix32(unsigned long t_state)
 			: _state(t_state) {}
 
+	static constexpr unsigned long long jumpSteps = 1ULL << 32;
+	static constexpr unsigned long long longJumpSteps = 1ULL << 48;
+
 	unsigned long operator()() {
 		unsigned long long result = _state;
 		_state = result + 0x9E3779B97f4A7C15ULL;
@@ -70,6 +178,24 @@ public:
 		result = (result ^ (result >> 27)) * 0x94D049BB133111EBULL;
 		return ((result ^ (result >> 31)) >> 32);
 	}
+
+	// The state walks by a fixed odd increment
+	void jump(unsigned long long t_steps) {
+		_state += t_steps * 0x9E3779B97f4A7C15ULL;
+	}
+
+	void jump() {
+		jump(jumpSteps);
+	}
+
+	void long_jump() {
+		jump(longJumpSteps);
+	}
+
+	splitmix32 split() {
+		unsigned long long high = operator()();
+		return splitmix32((high << 32) | operator()());
+	}
 };
 
 class splitmix64 {
@@ -81,6 +207,9 @@ public:
 	splitmix64(unsigned long t_state)
 			: _state(t_state) {}
 
+	static constexpr unsigned long long jumpSteps = 1ULL << 32;
+	static constexpr unsigned long long longJumpSteps = 1ULL << 48;
+
 	unsigned long operator()() {
 		unsigned long long result = _state;
 		_state = result + 0x9E3779B97f4A7C15ULL;
@@ -88,8 +217,74 @@ public:
 		result = (result ^ (result >> 27)) * 0x94D049BB133111EBULL;
 		return result ^ (result >> 31);
 	}
+
+	// The state walks by a fixed odd increment
+	void jump(unsigned long long t_steps) {
+		_state += t_steps * 0x9E3779B97f4A7C15ULL;
+	}
+
+	void jump() {
+		jump(jumpSteps);
+	}
+
+	void long_jump() {
+		jump(longJumpSteps);
+	}
+
+	splitmix64 split() {
+		return splitmix64(operator()());
+	}
 };
 
+// Jump-ahead for the 13/17/5 xorshift on a 64-bit state. One step is a
+// linear map T over GF(2)^64 whose characteristic polynomial is
+// x^64 + characteristic; T^n is the polynomial x^n reduced by it, applied
+// to the state. The polynomial has factors of degree 12, 14, 17 and 21, so
+// the longest cycle is 6914497698226755 steps, a little under 2^53
+namespace XorshiftJump {
+	const unsigned long long characteristic = 0x087277e777ac08cfULL;
+
+	// t_polynomial * x modulo the characteristic polynomial
+	inline unsigned long long shift(unsigned long long t_polynomial) {
+		return (t_polynomial << 1) ^ ((t_polynomial >> 63) ? characteristic : 0);
+	}
+
+	inline unsigned long long multiply(unsigned long long t_a, unsigned long long t_b) {
+		unsigned long long result = 0;
+		for (int bit = 63; bit >= 0; bit--) {
+			result = shift(result);
+			if ((t_b >> bit) & 1)
+				result ^= t_a;
+		}
+		return result;
+	}
+
+	// x^t_steps modulo the characteristic polynomial
+	inline unsigned long long polynomial(unsigned long long t_steps) {
+		unsigned long long result = 1;
+		for (int bit = 63; bit >= 0; bit--) {
+			result = multiply(result, result);
+			if ((t_steps >> bit) & 1)
+				result = shift(result);
+		}
+		return result;
+	}
+
+	// Sum of T^i(t_state) over the set bits i of the jump polynomial
+	inline unsigned long jump(unsigned long t_state, unsigned long long t_steps) {
+		unsigned long long jumpPolynomial = polynomial(t_steps);
+		unsigned long result = 0;
+		for (int bit = 0; bit < 64; bit++) {
+			if ((jumpPolynomial >> bit) & 1)
+				result ^= t_state;
+			t_state ^= t_state << 13;
+			t_state ^= t_state >> 17;
+			t_state ^= t_state << 5;
+		}
+		return result;
+	}
+}
+
 class xorshift32 {
 	unsigned long _state;
 public:
@@ -99,12 +294,31 @@ public:
 	xorshift32(unsigned long t_state)
 			: _state(splitmix32(t_state)()) {}
 
+	static constexpr unsigned long long jumpSteps = 1ULL << 32;
+	static constexpr unsigned long long longJumpSteps = 1ULL << 40;
+
 	unsigned long operator()() {
 		_state ^= _state << 13;
 		_state ^= _state >> 17;
 		_state ^= _state << 5;
 		return _state;
 	}
+
+	void jump(unsigned long long t_steps) {
+		_state = XorshiftJump::jump(_state, t_steps);
+	}
+
+	void jump() {
+		jump(jumpSteps);
+	}
+
+	void long_jump() {
+		jump(longJumpSteps);
+	}
+
+	xorshift32 split() {
+		return xorshift32(operator()());
+	}
 };
 
 class xorshift64 {
@@ -116,12 +330,266 @@ public:
 	xorshift64(unsigned long long t_state)
 			: _state(splitmix64(t_state)()) {}
 
+	static constexpr unsigned long long jumpSteps = 1ULL << 32;
+	static constexpr unsigned long long longJumpSteps = 1ULL << 40;
+
 	unsigned long operator()() {
 		_state ^= _state << 13;
 		_state ^= _state >> 17;
 		_state ^= _state << 5;
 		return _state;
 	}
+
+	void jump(unsigned long long t_steps) {
+		_state = XorshiftJump::jump(_state, t_steps);
+	}
+
+	void jump() {
+		jump(jumpSteps);
+	}
+
+	void long_jump() {
+		jump(longJumpSteps);
+	}
+
+	xorshift64 split() {
+		return xorshift64(operator()());
+	}
+};
+
+// Bulk generation: xoshiro256++ run in count interleaved lanes held in vectors of the
+// widest registers the processor has (AVX-512, AVX2 or SSE2, picked at run time). The
+// lanes don't depend on each other, so the vectors step in parallel instead of waiting
+// on one serial chain, and the output is the same whichever width runs it
+namespace RandomLanes {
+	const int count = 16;
+
+	// fills at least this long (32 MB) are written around the cache
+	const size_t streamThreshold = size_t(1) << 22;
+
+	template<int Bytes>
+	struct Width {
+		typedef unsigned long long lanes __attribute__((vector_size(Bytes)));
+		static const int count = Bytes / sizeof(unsigned long long);
+	};
+
+	// streaming stores go straight to memory rather than first reading the line into
+	// the cache; they need aligned whole vectors. Elsewhere they're plain stores
+	template<typename V>
+	__attribute__((always_inline)) inline void streamStore(uint64_t *t_to, const V &x) {
+		memcpy(t_to, &x, sizeof(V));
+	}
+
+	__attribute__((always_inline)) inline void fence() {
+#if defined(__x86_64__) || defined(__i386__)
+		_mm_sfence();
+#endif
+	}
+
+#if defined(__x86_64__) || defined(__i386__)
+	__attribute__((always_inline)) inline void streamStore(uint64_t *t_to, const Width<16>::lanes &x) {
+		_mm_stream_si128((__m128i *) t_to, (__m128i) x);
+	}
+
+	__attribute__((target("avx2"))) inline void streamStore(uint64_t *t_to, const Width<32>::lanes &x) {
+		_mm256_stream_si256((__m256i *) t_to, (__m256i) x);
+	}
+
+	__attribute__((target("avx512f"))) inline void streamStore(uint64_t *t_to, const Width<64>::lanes &x) {
+		_mm512_stream_si512((__m512i *) t_to, (__m512i) x);
+	}
+#endif
+
+	// t_blocks rounds of xoshiro256++ over the lanes of t_state (word w of lane k at
+	// t_state[w][k]), lane k of each round going to t_out[k]. Each state word takes
+	// count / W::count vectors, unrolled so that they all stay in registers
+	template<bool Stream>
+	struct Xoshiro {
+		template<typename W>
+		__attribute__((always_inline)) static inline void run(unsigned long long (*t_state)[count],
+		                                                      uint64_t *t_out, size_t t_blocks) {
+			typedef typename W::lanes V;
+			const int groups = count / W::count;
+			V s[4][groups];
+			for (int w = 0; w < 4; w++)
+				memcpy(s[w], t_state[w], sizeof(s[w]));
+			for (size_t block = 0; block < t_blocks; block++, t_out += count) {
+#pragma GCC unroll 16
+				for (int g = 0; g < groups; g++) {
+					V sum = s[0][g] + s[3][g];
+					V result = ((sum << 23) | (sum >> 41)) + s[0][g];
+					if (Stream)
+						streamStore(t_out + g * W::count, result);
+					else
+						memcpy(t_out + g * W::count, &result, sizeof(V));
+					V shifted = s[1][g] << 17;
+					s[2][g] ^= s[0][g];
+					s[3][g] ^= s[1][g];
+					s[1][g] ^= s[2][g];
+					s[0][g] ^= s[3][g];
+					s[2][g] ^= shifted;
+					s[3][g] = (s[3][g] << 45) | (s[3][g] >> 19);
+				}
+			}
+			if (Stream)
+				fence();
+			for (int w = 0; w < 4; w++)
+				memcpy(t_state[w], s[w], sizeof(s[w]));
+		}
+	};
+
+#if defined(__x86_64__) || defined(__i386__)
+	template<typename K, typename... A>
+	__attribute__((target("avx512f"))) void runAvx512(A... t_args) {
+		K::template run<Width<64>>(t_args...);
+	}
+
+	template<typename K, typename... A>
+	__attribute__((target("avx2"))) void runAvx2(A... t_args) {
+		K::template run<Width<32>>(t_args...);
+	}
+#endif
+
+	template<typename K, typename... A>
+	void runAll(A... t_args) {
+#if defined(__x86_64__) || defined(__i386__)
+		static const int level = __builtin_cpu_supports("avx512f") ? 2 : (__builtin_cpu_supports("avx2") ? 1 : 0);
+		if (level == 2)
+			return runAvx512<K>(t_args...);
+		if (level == 1)
+			return runAvx2<K>(t_args...);
+#endif
+		K::template run<Width<16>>(t_args...);
+	}
+}
+
+// xoshiro256++ in RandomLanes::count interleaved lanes, for filling large buffers.
+// Lane k starts k jumps (2^128 draws) after the seeded state, and draw i comes from
+// lane i % count, so the sequence depends only on the seed, and fill() and
+// operator() continue one another
+class xoshiro256x16 {
+	unsigned long long _state[4][RandomLanes::count];
+	uint64_t _buffer[RandomLanes::count];
+	int _buffered = 0;
+
+	static void step(unsigned long long *s) {
+		unsigned long long shifted = s[1] << 17;
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= shifted;
+		s[3] = (s[3] << 45) | (s[3] >> 19);
+	}
+
+	// Advance t_lane by the xoshiro256 jump polynomial t_polynomial, lowest word first
+	static void jumpLane(unsigned long long *t_lane, const unsigned long long *t_polynomial) {
+		unsigned long long result[4] = {};
+		for (int i = 0; i < 4; i++)
+			for (int bit = 0; bit < 64; bit++) {
+				if ((t_polynomial[i] >> bit) & 1)
+					for (int w = 0; w < 4; w++)
+						result[w] ^= t_lane[w];
+				step(t_lane);
+			}
+		memcpy(t_lane, result, sizeof(result));
+	}
+
+	// x^(2^128) and x^(2^192) modulo the characteristic polynomial
+	static const unsigned long long *jumpPolynomial() {
+		static const unsigned long long polynomial[4] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+		                                                 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+		return polynomial;
+	}
+
+	static const unsigned long long *longJumpPolynomial() {
+		static const unsigned long long polynomial[4] = {0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL,
+		                                                 0x77710069854ee241ULL, 0x39109bb02acbe635ULL};
+		return polynomial;
+	}
+
+	void refill() {
+		RandomLanes::runAll<RandomLanes::Xoshiro<false>>(_state, _buffer, size_t(1));
+		_buffered = RandomLanes::count;
+	}
+
+public:
+	xoshiro256x16()
+			: xoshiro256x16(2147483647ULL) {}
+
+	xoshiro256x16(unsigned long long t_seed) {
+		splitmix64 seeder(t_seed);
+		unsigned long long lane[4];
+		for (int w = 0; w < 4; w++)
+			lane[w] = seeder();
+		for (int k = 0; k < RandomLanes::count; k++) {
+			for (int w = 0; w < 4; w++)
+				_state[w][k] = lane[w];
+			jumpLane(lane, jumpPolynomial());
+		}
+	}
+
+	unsigned long long operator()() {
+		if (_buffered == 0)
+			refill();
+		return _buffer[RandomLanes::count - _buffered--];
+	}
+
+	void fill(uint64_t *t_out, size_t t_n) {
+		size_t i = 0;
+		for (; i < t_n && _buffered > 0; i++)
+			t_out[i] = _buffer[RandomLanes::count - _buffered--];
+		size_t blocks = (t_n - i) / RandomLanes::count;
+		if (t_n - i >= RandomLanes::streamThreshold && (uintptr_t) (t_out + i) % 64 == 0)
+			RandomLanes::runAll<RandomLanes::Xoshiro<true>>(_state, t_out + i, blocks);
+		else
+			RandomLanes::runAll<RandomLanes::Xoshiro<false>>(_state, t_out + i, blocks);
+		for (i += blocks * RandomLanes::count; i < t_n; i++)
+			t_out[i] = operator()();
+	}
+
+	// Every lane moves 2^192 draws on, past the 2^132 that all lanes together span,
+	// giving 2^64 streams. The drawn but unread values are dropped
+	void jump() {
+		for (int k = 0; k < RandomLanes::count; k++) {
+			unsigned long long lane[4] = {_state[0][k], _state[1][k], _state[2][k], _state[3][k]};
+			jumpLane(lane, longJumpPolynomial());
+			for (int w = 0; w < 4; w++)
+				_state[w][k] = lane[w];
+		}
+		_buffered = 0;
+	}
+
+	xoshiro256x16 split() {
+		return xoshiro256x16(operator()());
+	}
 };
 
+inline linear32 linear32::split() {
+	return linear32(splitmix32(operator()())());
+}
+
+inline linear64 linear64::split() {
+	return linear64(splitmix64(operator()())());
+}
+
+// Generator for stream t_index of t_seed, e.g. one per thread. Streams of
+// a seed start jumpSteps draws apart, so they don't overlap for that many
+// draws each and a run hands the same stream to the same index every time
+template<typename Generator>
+Generator randomStream(unsigned long long t_seed, unsigned long long t_index) {
+	Generator result(t_seed);
+	result.jump(t_index * Generator::jumpSteps);
+	return result;
+}
+
+// xoshiro256x16 jumps a fixed 2^192 draws, so stream t_index takes t_index jumps
+template<>
+inline xoshiro256x16 randomStream<xoshiro256x16>(unsigned long long t_seed, unsigned long long t_index) {
+	xoshiro256x16 result(t_seed);
+	for (unsigned long long i = 0; i < t_index; i++)
+		result.jump();
+	return result;
+}
+
 #endif //RANDOM_HPP
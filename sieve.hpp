@@ -0,0 +1,466 @@
+// Artem Mikheev 2020
+// GNU GPLv3 License
+
+#include "thread_pool.hpp"
+#include "vector.hpp"
+#include "vartypes.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef SIEVE_HPP
+#define SIEVE_HPP
+
+// Segmented sieve of Eratosthenes over the mod 30 wheel.
+// Every byte of a segment covers 30 consecutive numbers with one bit for each of the
+// 8 residues coprime to 30, so 2, 3 and 5 never appear in the bitmap.
+// Segments are 32 KiB, which stay in L1 while they are crossed off and cover 983040
+// numbers, until there are so many sieving primes that walking their list for every
+// segment costs more than the misses of a larger one. From there they grow with the
+// number of sieving primes up to 1 MiB, about the size of L2.
+// Multiples of 7, 11, 13 and 17 are not crossed off one by one: each segment starts
+// as a copy of their combined pattern, which repeats every 7 * 11 * 13 * 17 bytes.
+// Bounds are inclusive and may go up to maxValue
+
+namespace Sieve {
+	const uint64_t maxValue = 1ULL << 62;
+
+	const sizeT minSegmentBytes = 32 * 1024;
+
+	const sizeT maxSegmentBytes = 1024 * 1024;
+
+	const sizeT patternBytes = 7 * 11 * 13 * 17;
+
+	const uint8_t wheel[9] = {1, 7, 11, 13, 17, 19, 23, 29, 31};
+
+	// wheel index of every residue mod 30, 8 for residues sharing a factor with 30
+	const uint8_t wheelIndex[30] = {8, 0, 8, 8, 8, 8, 8, 1, 8, 8, 8, 2, 8, 3, 8,
+	                                8, 8, 4, 8, 5, 8, 8, 8, 6, 8, 8, 8, 8, 8, 7};
+
+	// A multiple p * k with k = 30a + wheel[j] sits in byte p*a + (p/30)*wheel[j] + start[r][j]
+	// under the bit mask[r][j], r being the wheel index of p mod 30.
+	// Going from wheel[j] to wheel[j+1] moves it by (p/30)*gap[j] + carry[r][j] bytes
+	struct WheelTables {
+		uint8_t mask[8][8];
+		uint8_t start[8][8];
+		uint8_t carry[8][8];
+		uint8_t gap[8];
+
+		WheelTables() {
+			for (sizeT r = 0; r < 8; r++)
+				for (sizeT j = 0; j < 8; j++) {
+					mask[r][j] = 1 << wheelIndex[wheel[r] * wheel[j] % 30];
+					start[r][j] = wheel[r] * wheel[j] / 30;
+					carry[r][j] = wheel[r] * wheel[j + 1] / 30 - start[r][j];
+				}
+			for (sizeT j = 0; j < 8; j++)
+				gap[j] = wheel[j + 1] - wheel[j];
+		}
+	};
+
+	inline const WheelTables &tables() {
+		static const WheelTables t;
+		return t;
+	}
+
+	// bitmap of the numbers free of the factors 7, 11, 13 and 17
+	inline const uint8_t *pattern() {
+		static const Vector<uint8_t> bytes = [] {
+			Vector<uint8_t> result(patternBytes);
+			for (sizeT i = 0; i < patternBytes; i++) {
+				uint8_t byte = 0;
+				for (sizeT j = 0; j < 8; j++) {
+					uint32_t n = 30 * i + wheel[j];
+					if (n % 7 && n % 11 && n % 13 && n % 17)
+						byte |= 1 << j;
+				}
+				result[i] = byte;
+			}
+			return result;
+		}();
+		return bytes.data();
+	}
+
+	inline uint64_t isqrt(uint64_t t_n) {
+		uint64_t r = std::sqrt((long double) t_n);
+		while (r * r > t_n)
+			r--;
+		while ((r + 1) * (r + 1) <= t_n)
+			r++;
+		return r;
+	}
+
+	// Sieving prime together with the position of its next multiple
+	struct Multiple {
+		uint64_t next;   // byte of the multiple, counted from the start of the current segment
+		uint32_t prime;
+		uint8_t residue; // wheel index of prime mod 30
+		uint8_t step;    // wheel index of the cofactor mod 30
+	};
+
+	// Crosses off consecutive segments starting at t_low, which must be a multiple of 30
+	class Crosser {
+		Vector<Multiple> _multiples;
+
+	public:
+		Crosser(const Vector<uint32_t> &t_primes, uint64_t t_low, uint64_t t_high) {
+			for (sizeT i = 0; i < *t_primes.size; i++) {
+				uint64_t p = t_primes[i];
+				if (p * p > t_high)
+					break;
+				// first cofactor k >= p coprime to 30 with p * k >= t_low
+				uint64_t k = (t_low + p - 1) / p;
+				if (k < p)
+					k = p;
+				uint64_t a = k / 30;
+				uint8_t j = 0;
+				while (wheel[j] < k % 30)
+					j++;
+				if (j == 8) {
+					a++;
+					j = 0;
+				}
+				Multiple m;
+				m.next = p * (30 * a + wheel[j]) / 30 - t_low / 30;
+				m.prime = p;
+				m.residue = wheelIndex[p % 30];
+				m.step = j;
+				_multiples.push(m);
+			}
+		}
+
+		// Fills t_bytes bytes of t_segment with the bitmap of the segment at t_low and moves
+		// every multiple on to the following segment
+		void sieve(uint8_t *t_segment, uint64_t t_low, sizeT t_bytes) {
+			const uint8_t *bits = pattern();
+			sizeT offset = (t_low / 30) % patternBytes;
+			for (sizeT done = 0; done < t_bytes;) {
+				sizeT chunk = Algorithm::min(t_bytes - done, patternBytes - offset);
+				memcpy(t_segment + done, bits + offset, chunk);
+				done += chunk;
+				offset = 0;
+			}
+			// the pattern dropped 7, 11, 13 and 17 themselves and kept 1
+			if (t_low == 0)
+				t_segment[0] = 0xfe;
+
+			const WheelTables &t = tables();
+			Multiple *multiples = _multiples.data();
+			for (sizeT m = 0; m < *_multiples.size; m++) {
+				uint64_t i = multiples[m].next;
+				if (i >= t_bytes) {
+					multiples[m].next = i - t_bytes;
+					continue;
+				}
+				const uint32_t p = multiples[m].prime, q = p / 30;
+				const uint8_t r = multiples[m].residue;
+				uint8_t j = multiples[m].step;
+				const uint8_t *mask = t.mask[r], *carry = t.carry[r];
+				while (i < t_bytes) {
+					if (j == 0 && i + p <= t_bytes) {
+						// whole turns of the wheel move every multiple by exactly p bytes
+						const uint32_t o1 = q * 6 + t.start[r][1], o2 = q * 10 + t.start[r][2],
+						               o3 = q * 12 + t.start[r][3], o4 = q * 16 + t.start[r][4],
+						               o5 = q * 18 + t.start[r][5], o6 = q * 22 + t.start[r][6],
+						               o7 = q * 28 + t.start[r][7];
+						const uint8_t m0 = ~mask[0], m1 = ~mask[1], m2 = ~mask[2], m3 = ~mask[3],
+						              m4 = ~mask[4], m5 = ~mask[5], m6 = ~mask[6], m7 = ~mask[7];
+						uint8_t *s = t_segment + i;
+						uint8_t *end = t_segment + t_bytes - p;
+						for (; s <= end; s += p) {
+							s[0] &= m0;
+							s[o1] &= m1;
+							s[o2] &= m2;
+							s[o3] &= m3;
+							s[o4] &= m4;
+							s[o5] &= m5;
+							s[o6] &= m6;
+							s[o7] &= m7;
+						}
+						i = s - t_segment;
+						if (i >= t_bytes)
+							break;
+					}
+					t_segment[i] &= ~mask[j];
+					i += q * t.gap[j] + carry[j];
+					j = (j + 1) & 7;
+				}
+				multiples[m].next = i - t_bytes;
+				multiples[m].step = j;
+			}
+		}
+	};
+
+	// Sieving primes for bounds up to t_to, that is the primes from 19 up to sqrt(t_to)
+	inline Vector<uint32_t> sievingPrimes(uint64_t t_to);
+
+	// Clears the bits of the numbers outside of [t_from, t_to] in a sieved segment and pads
+	// a partial last segment with zeros up to a whole 64 bit word
+	inline void clip(uint8_t *t_segment, uint64_t t_low, sizeT t_bytes, uint64_t t_from, uint64_t t_to) {
+		if (t_low <= t_from)
+			for (sizeT j = 0; j < 8; j++)
+				if (t_low + wheel[j] < t_from)
+					t_segment[0] &= ~(1 << j);
+		uint64_t last = t_low + 30ULL * (t_bytes - 1);
+		for (sizeT j = 0; j < 8; j++)
+			if (last + wheel[j] > t_to)
+				t_segment[t_bytes - 1] &= ~(1 << j);
+		memset(t_segment + t_bytes, 0, (8 - t_bytes % 8) % 8);
+	}
+
+	inline sizeT segmentSize(const Vector<uint32_t> &t_primes) {
+		sizeT bytes = minSegmentBytes;
+		while (bytes < 8 * *t_primes.size && bytes < maxSegmentBytes)
+			bytes *= 2;
+		return bytes;
+	}
+
+	// Calls t_f(bitmap, low, bytes) for consecutive segments covering [t_from, t_to],
+	// with the bits outside of the range already cleared and the bitmap zero padded
+	// to a whole number of 64 bit words
+	template<typename F>
+	void segments(const Vector<uint32_t> &t_primes, uint64_t t_from, uint64_t t_to, const F &t_f) {
+		uint64_t low = t_from / 30 * 30;
+		uint64_t lastByte = t_to / 30;
+		Crosser crosser(t_primes, low, t_to);
+		sizeT segmentBytes = segmentSize(t_primes);
+		Vector<uint64_t> buffer(segmentBytes / 8);
+		uint8_t *segment = reinterpret_cast<uint8_t *>(buffer.data());
+		while (true) {
+			uint64_t left = lastByte - low / 30 + 1;
+			sizeT bytes = left < segmentBytes ? left : segmentBytes;
+			crosser.sieve(segment, low, bytes);
+			clip(segment, low, bytes, t_from, t_to);
+			t_f(segment, low, bytes);
+			if (bytes == left)
+				return;
+			low += 30ULL * segmentBytes;
+		}
+	}
+
+	inline uint64_t countBits(const uint8_t *t_bitmap, uint64_t t_bytes) {
+		uint64_t count = 0;
+		const uint64_t *words = reinterpret_cast<const uint64_t *>(t_bitmap);
+		for (uint64_t i = 0; i < (t_bytes + 7) / 8; i++)
+			count += __builtin_popcountll(words[i]);
+		return count;
+	}
+
+	// Calls t_f(prime) for every bit set in the bitmap of t_bytes bytes starting at t_low
+	template<typename F>
+	void forEachBit(const uint8_t *t_bitmap, uint64_t t_low, uint64_t t_bytes, const F &t_f) {
+		const uint64_t *words = reinterpret_cast<const uint64_t *>(t_bitmap);
+		for (uint64_t i = 0; i < (t_bytes + 7) / 8; i++) {
+			uint64_t word = words[i];
+			uint64_t base = t_low + 240 * i;
+			while (word) {
+				int bit = __builtin_ctzll(word);
+				word &= word - 1;
+				t_f(base + 30 * (bit >> 3) + wheel[bit & 7]);
+			}
+		}
+	}
+
+	// the primes 2, 3 and 5 which the wheel leaves out
+	const uint8_t smallPrimes[3] = {2, 3, 5};
+
+	template<typename F>
+	void forEachSmall(uint64_t t_from, uint64_t t_to, const F &t_f) {
+		for (sizeT i = 0; i < 3; i++)
+			if (t_from <= smallPrimes[i] && smallPrimes[i] <= t_to)
+				t_f((uint64_t) smallPrimes[i]);
+	}
+
+	inline void checkRange(uint64_t t_to) {
+		if (t_to > maxValue)
+			throw std::out_of_range("Sieve bound is larger than Sieve::maxValue.");
+	}
+
+	inline Vector<uint32_t> sievingPrimes(uint64_t t_to) {
+		Vector<uint32_t> result;
+		uint64_t root = isqrt(t_to);
+		if (root < 19)
+			return result;
+		Vector<uint32_t> primes = sievingPrimes(root);
+		segments(primes, 19, root, [&](const uint8_t *t_bitmap, uint64_t t_low, sizeT t_bytes) {
+			forEachBit(t_bitmap, t_low, t_bytes, [&](uint64_t p) { result.push(p); });
+		});
+		return result;
+	}
+
+	// Number of primes in [t_from, t_to]. With a pool the range is split into one run
+	// of segments per thread and every run sieves with its own copy of the multiples
+	inline uint64_t count(uint64_t t_from, uint64_t t_to, ThreadPool *t_pool = nullptr) {
+		checkRange(t_to);
+		uint64_t result = 0;
+		forEachSmall(t_from, t_to, [&](uint64_t) { result++; });
+		if (t_from < 7)
+			t_from = 7;
+		if (t_from > t_to)
+			return result;
+		Vector<uint32_t> primes = sievingPrimes(t_to);
+		auto countRange = [&](uint64_t t_low, uint64_t t_high) {
+			uint64_t found = 0;
+			segments(primes, t_low, t_high, [&](const uint8_t *t_bitmap, uint64_t, sizeT t_bytes) {
+				found += countBits(t_bitmap, t_bytes);
+			});
+			return found;
+		};
+		if (t_pool == nullptr)
+			return result + countRange(t_from, t_to);
+		sizeT pieces = *t_pool->size + 1;
+		sizeT segmentBytes = segmentSize(primes);
+		uint64_t base = t_from / 30 * 30;
+		uint64_t total = (t_to / 30 - base / 30) / segmentBytes + 1;
+		uint64_t span = (total + pieces - 1) / pieces * 30 * segmentBytes;
+		Vector<uint64_t> found(pieces);
+		t_pool->parallelFor(pieces, [&](sizeT i) {
+			uint64_t low = base + i * span;
+			if (low > t_to)
+				return;
+			uint64_t high = t_to - low < span ? t_to : low + span - 1;
+			found[i] = countRange(Algorithm::max(low, t_from), high);
+		});
+		for (sizeT i = 0; i < pieces; i++)
+			result += found[i];
+		return result;
+	}
+
+	// Number of primes up to t_n
+	inline uint64_t count(uint64_t t_n, ThreadPool *t_pool = nullptr) {
+		return count(0, t_n, t_pool);
+	}
+
+	// Calls t_f(prime) for every prime in [t_from, t_to] in increasing order, always from
+	// the calling thread. With a pool the workers sieve the next 1 MiB of bitmap each
+	// into separate buffers, which are then walked in order
+	template<typename F>
+	void forEachPrime(uint64_t t_from, uint64_t t_to, const F &t_f, ThreadPool *t_pool = nullptr) {
+		checkRange(t_to);
+		forEachSmall(t_from, t_to, t_f);
+		if (t_from < 7)
+			t_from = 7;
+		if (t_from > t_to)
+			return;
+		Vector<uint32_t> primes = sievingPrimes(t_to);
+		if (t_pool == nullptr) {
+			segments(primes, t_from, t_to, [&](const uint8_t *t_bitmap, uint64_t t_low, sizeT t_bytes) {
+				forEachBit(t_bitmap, t_low, t_bytes, t_f);
+			});
+			return;
+		}
+		sizeT segmentBytes = segmentSize(primes);
+		sizeT blockSegments = maxSegmentBytes / segmentBytes;
+		uint64_t blockSpan = 30ULL * segmentBytes * blockSegments;
+		sizeT blocks = *t_pool->size + 1;
+		Vector<uint8_t> bitmaps(blocks * blockSegments * segmentBytes);
+		Vector<uint64_t> used(blocks);
+		for (uint64_t low = t_from / 30 * 30; low <= t_to; low += blockSpan * blocks) {
+			t_pool->parallelFor(blocks, [&](sizeT i) {
+				uint64_t start = low + i * blockSpan;
+				used[i] = 0;
+				if (start > t_to)
+					return;
+				uint64_t end = t_to - start < blockSpan ? t_to : start + blockSpan - 1;
+				uint8_t *bitmap = bitmaps.data() + i * blockSegments * segmentBytes;
+				segments(primes, Algorithm::max(start, t_from), end,
+				         [&](const uint8_t *t_bitmap, uint64_t t_low, sizeT t_bytes) {
+					         memcpy(bitmap + (t_low - start) / 30, t_bitmap, (t_bytes + 7) / 8 * 8);
+					         used[i] = (t_low - start) / 30 + t_bytes;
+				         });
+			});
+			for (sizeT i = 0; i < blocks; i++)
+				forEachBit(bitmaps.data() + i * blockSegments * segmentBytes, low + i * blockSpan, used[i], t_f);
+		}
+	}
+
+	// Walks the primes of [t_from, t_to] one at a time, sieving a segment whenever the
+	// previous one runs out. next() returns 0 once the range is exhausted
+	class Iterator {
+		uint64_t _from, _to;
+		Vector<uint32_t> _primes;
+		Crosser *_crosser = nullptr;
+		sizeT _segmentBytes = 0;
+		Vector<uint64_t> _bitmap;
+		uint64_t _low = 0;
+		sizeT _words = 0, _word = 0;
+		uint64_t _bits = 0;
+		bool _done = false;
+
+		// sieves the segment after the current one, returns false past the end of the range
+		bool advance() {
+			if (_crosser == nullptr) {
+				_low = _from / 30 * 30;
+				_crosser = new Crosser(_primes, _low, _to);
+				_segmentBytes = segmentSize(_primes);
+				_bitmap.resize(_segmentBytes / 8);
+			} else {
+				_low += 30ULL * _segmentBytes;
+			}
+			if (_low > _to)
+				return false;
+			uint64_t left = _to / 30 - _low / 30 + 1;
+			sizeT bytes = left < _segmentBytes ? left : _segmentBytes;
+			uint8_t *segment = reinterpret_cast<uint8_t *>(_bitmap.data());
+			_crosser->sieve(segment, _low, bytes);
+			clip(segment, _low, bytes, _from, _to);
+			_words = (bytes + 7) / 8;
+			_word = 0;
+			_bits = _bitmap.data()[0];
+			return true;
+		}
+
+	public:
+		Iterator(uint64_t t_from, uint64_t t_to)
+				: _from(t_from),
+				  _to(t_to) {
+			checkRange(t_to);
+			if (_from < 7)
+				_from = 7;
+			if (_from <= _to)
+				_primes = sievingPrimes(_to);
+			else
+				_done = true;
+			// until the first segment is sieved _bits marks the small primes still to come
+			for (sizeT i = 0; i < 3; i++)
+				if (t_from <= smallPrimes[i] && smallPrimes[i] <= t_to)
+					_bits |= 1 << i;
+		}
+
+		Iterator(const Iterator &other) = delete;
+
+		Iterator &operator=(const Iterator &other) = delete;
+
+		~Iterator() {
+			delete _crosser;
+		}
+
+		uint64_t next() {
+			if (_crosser == nullptr && _bits) {
+				int i = __builtin_ctzll(_bits);
+				_bits &= _bits - 1;
+				return smallPrimes[i];
+			}
+			if (_done)
+				return 0;
+			if (_crosser == nullptr && !advance()) {
+				_done = true;
+				return 0;
+			}
+			while (_bits == 0) {
+				if (++_word < _words) {
+					_bits = _bitmap.data()[_word];
+				} else if (!advance()) {
+					_done = true;
+					return 0;
+				}
+			}
+			int bit = __builtin_ctzll(_bits);
+			_bits &= _bits - 1;
+			return _low + 240 * _word + 30 * (bit >> 3) + wheel[bit & 7];
+		}
+	};
+}
+
+#endif //SIEVE_HPP
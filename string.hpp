@@ -22,6 +22,12 @@ public:
 	String(const String &other)
 	: _charData(other._charData) {}
 
+	// size keeps pointing at this string's own vector
+	String &operator=(const String &other) {
+		_charData = other._charData;
+		return *this;
+	}
+
 	String(std::initializer_list<char32_t> arr) {
 		sizeT n = arr.size();
 		if (*(arr.end()-1) == U'\0') {
@@ -131,6 +137,12 @@ public:
 		return result;
 	}
 
+	// Raw access to the characters, used for bulk conversions such as BigInt::getValue
+	char32_t *data() const
+	{
+		return _charData.data();
+	}
+
 	char32_t& operator[](int index) const
 	{
 		return _charData[index];
@@ -0,0 +1,64 @@
+// Artem Mikheev 2020
+// GNU GPLv3 License
+
+#include "string.hpp"
+#include "utility.hpp"
+#include "big_float.hpp"
+#include <cstdio>
+#include <cstring>
+
+// sin and cos at 256 bits near 0 and near multiples of pi, where the reduced argument is
+// far below 1, against 100 digit references. The results have to be within 2^-254 relative
+
+static int failures = 0;
+
+static BigFloat fromText(const char *t_text, uint32 t_precision) {
+	sizeT n = strlen(t_text);
+	String text(n);
+	for (sizeT i = 0; i < n; i++)
+		text[i] = t_text[i];
+	return BigFloat(text, t_precision);
+}
+
+static void expect(const char *t_name, const BigFloat &t_value, const char *t_reference) {
+	BigFloat reference = fromText(t_reference, 400), error = BigFloat(t_value, 400) - reference;
+	if (error.isNegative())
+		error = -error;
+	BigFloat bound = reference.isNegative() ? -reference : reference;
+	if (error > bound.ldexp(-254)) {
+		printf("%s is off by %Lg relative\n", t_name, (error / bound).toLongDouble());
+		failures++;
+	}
+}
+
+static void expectEqual(const char *t_name, const BigFloat &t_value, const BigFloat &t_expected) {
+	if (t_value != t_expected) {
+		printf("%s is %Lg instead of %Lg\n", t_name, t_value.toLongDouble(), t_expected.toLongDouble());
+		failures++;
+	}
+}
+
+int main() {
+	// the first calls fill the caches of pi and ln 2 at precisions below 3 bits
+	expectEqual("pi(2)", BigFloat::pi(2), BigFloat((int64) 3, 2));
+	expectEqual("ln2(2)", BigFloat::ln2(2), BigFloat(0.75L, 2));
+	expectEqual("pi(1)", BigFloat::pi(1), BigFloat((int64) 4, 1));
+
+	BigFloat small = (BigFloat((int64) 1, 256) / BigFloat((int64) 3, 256)).ldexp(-200);
+	BigFloat pi = BigFloat::pi(256);
+	expect("sin(2^-200 / 3)", small.sin(),
+	       "2.074338425953713902381354684593374746863417389573722377700372204929899611345136770896125030493573594e-61");
+	expect("sin(7 * 2^-5000)", BigFloat((int64) 7, 256).ldexp(-5000).sin(),
+	       "4.955867882733721024669930611085840287063283957237601951110881156482457081432851966498556320247465936e-1505");
+	expect("sin(pi)", pi.sin(),
+	       "1.096917440979352076742130626395698021050758236508687951179005716992142688513350882170586671696937086e-77");
+	expect("cos(pi / 2)", pi.ldexp(-1).cos(),
+	       "5.484587204896760383710653131978490105253791182543439755895028584960713442566754410852933358484685428e-78");
+	expect("sin(3 pi)", (pi * BigFloat((int64) 3, 256)).sin(),
+	       "-3.618182521137499470082689611053225593740525582022961254481945625158445376989888999865445987687019324e-77");
+	expect("sin(1000 pi)", (pi * BigFloat((int64) 1000, 256)).sin(),
+	       "-1.815446664763209869574275101380691265367609466829786562412977845710169526536464813393816095985831466e-74");
+	expect("sin(1)", BigFloat((int64) 1, 256).sin(),
+	       "8.414709848078965066525023216302989996225630607983710656727517099919104043912396689486397435430526959e-1");
+	return failures != 0;
+}
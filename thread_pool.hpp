@@ -0,0 +1,120 @@
+// Artem Mikheev 2020
+// GNU GPLv3 License
+
+#include "vector.hpp"
+#include "vartypes.hpp"
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+// Fixed set of worker threads taking tasks from a shared list.
+// parallelFor blocks until all of its tasks are done and the calling thread runs
+// pending tasks while it waits, so tasks may call parallelFor on the same pool
+
+class ThreadPool {
+	std::thread *_workers;
+	sizeT _workerCount;
+	Vector<std::function<void()>> _tasks;
+	std::mutex _mutex;
+	std::condition_variable _taskAdded, _taskDone;
+	bool _stopping = false;
+
+	// runs one pending task with the lock released, returns false if there was none
+	bool runPending(std::unique_lock<std::mutex> &t_lock) {
+		if (*_tasks.size == 0)
+			return false;
+		std::function<void()> task = _tasks.back();
+		_tasks.pop();
+		t_lock.unlock();
+		task();
+		t_lock.lock();
+		return true;
+	}
+
+	void work() {
+		std::unique_lock<std::mutex> lock(_mutex);
+		while (true) {
+			_taskAdded.wait(lock, [this] { return _stopping || *_tasks.size > 0; });
+			if (*_tasks.size == 0)
+				return;
+			runPending(lock);
+		}
+	}
+
+public:
+	const sizeT *size = &_workerCount;
+
+	// 0 threads means one per hardware thread, minus the caller of parallelFor
+	explicit ThreadPool(sizeT t_threads = 0) {
+		if (t_threads == 0) {
+			sizeT hardware = std::thread::hardware_concurrency();
+			t_threads = hardware > 1 ? hardware - 1 : 1;
+		}
+		_workerCount = t_threads;
+		_workers = new std::thread[_workerCount];
+		for (sizeT i = 0; i < _workerCount; i++)
+			_workers[i] = std::thread([this] { work(); });
+	}
+
+	ThreadPool(const ThreadPool &other) = delete;
+
+	ThreadPool &operator=(const ThreadPool &other) = delete;
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stopping = true;
+		}
+		_taskAdded.notify_all();
+		for (sizeT i = 0; i < _workerCount; i++)
+			_workers[i].join();
+		delete[] _workers;
+	}
+
+	// Calls t_body(i) for every i in [0, t_n), spread over the workers and the calling thread.
+	// The first exception thrown by t_body is rethrown once every call has finished
+	template<typename F>
+	void parallelFor(sizeT t_n, const F &t_body) {
+		if (t_n == 0)
+			return;
+		sizeT remaining = t_n;
+		std::exception_ptr error;
+		auto call = [&](sizeT i) {
+			std::exception_ptr caught;
+			try {
+				t_body(i);
+			} catch (...) {
+				caught = std::current_exception();
+			}
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (caught && !error)
+				error = caught;
+			if (--remaining == 0)
+				_taskDone.notify_all();
+		};
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			for (sizeT i = t_n - 1; i > 0; i--)
+				_tasks.push([&call, i] { call(i); });
+		}
+		_taskAdded.notify_all();
+		// callers waiting inside other parallelFor calls can help with these too
+		_taskDone.notify_all();
+		call(0);
+		std::unique_lock<std::mutex> lock(_mutex);
+		while (remaining > 0) {
+			if (!runPending(lock))
+				_taskDone.wait(lock, [&] { return remaining == 0 || *_tasks.size > 0; });
+		}
+		lock.unlock();
+		if (error)
+			std::rethrow_exception(error);
+	}
+};
+
+#endif //THREAD_POOL_HPP
@@ -1,9 +1,19 @@
 // Artem Mikheev 2020
 // GNU GPLv3 License
 
+#include <cstdint>
+
 #ifndef VARTYPES_HPP
 #define VARTYPES_HPP
 
 typedef uint32_t sizeT;
 
+typedef uint64_t uint64;
+typedef int64_t int64;
+typedef uint32_t uint32;
+typedef int32_t int32;
+typedef uint16_t uint16;
+typedef int16_t int16;
+typedef uint8_t ubyte;
+
 #endif //VARTYPES_HPP
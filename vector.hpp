@@ -115,7 +115,7 @@ public:
 		int oldSize = _currentSize;
 		resize(_currentSize + other._currentSize);
 		for (int i = oldSize; i < _currentSize; i++)
-			_baseArray[i] = other._baseArray[i];
+			_baseArray[i] = other._baseArray[i - oldSize];
 		return *this;
 	}
 
@@ -127,17 +127,27 @@ public:
 		return true;
 	}
 
+	// Raw access to the underlying array, used by the limb kernels in big.hpp
+	T *data() const
+	{
+		return _baseArray;
+	}
+
 	void resize(sizeT t_n, T t_default = {})
 	{
 		if (t_n > _currentMaxSize) {
-			T *tmpArray = new T[t_n];
+			sizeT newMaxSize = (t_n & (-t_n)) == t_n ? t_n : Math::roundToNextPowerOfTwo(t_n);
+			T *tmpArray = new T[newMaxSize];
 			Algorithm::copy(_baseArray, tmpArray, _currentSize);
 			Algorithm::fill(tmpArray + _currentSize, tmpArray + t_n, t_default);
-			_currentSize = t_n;
+			if (_baseArray != nullptr)
+				delete[] _baseArray;
 			_baseArray = tmpArray;
-		} else {
-			_currentSize = t_n;
+			_currentMaxSize = newMaxSize;
+		} else if (t_n > _currentSize) {
+			Algorithm::fill(_baseArray + _currentSize, _baseArray + t_n, t_default);
 		}
+		_currentSize = t_n;
 	}
 
 	void clear()
@@ -146,16 +156,15 @@ public:
 			_currentSize = 0;
 			_currentMaxSize = 0;
 			delete[] _baseArray;
+			_baseArray = nullptr;
 		}
 	}
 
 	void push(T t_value)
 	{
-		if (_currentMaxSize == 0)
-			Vector();
-		if (_currentSize == _currentMaxSize)
-			resize(_currentMaxSize*2);
-		_baseArray[_currentSize++] = t_value;
+		sizeT oldSize = _currentSize;
+		resize(oldSize + 1);
+		_baseArray[oldSize] = t_value;
 	}
 
 	void pop()